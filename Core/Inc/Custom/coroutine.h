@@ -0,0 +1,120 @@
+/*
+ * coroutine.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#ifndef INC_CUSTOM_COROUTINE_H_
+#define INC_CUSTOM_COROUTINE_H_
+
+#include "Custom/scheduler.h"
+#include "Custom/software_timer.h"
+#include "main.h"
+
+/*
+ * NOTE:
+ * Stackless coroutine (protothread) on top of the scheduler, for task that have to
+ * wait in the middle of their work (for a conversion, a transmit, a delay) without
+ * blocking the other task.
+ *
+ * A coroutine is an event task (Custom_Scheduler_AddEvent) taking its Coroutine_t as
+ * argument. A wait store where the task is (the line number) and return, the next run
+ * jump back there through a switch. So:
+ * - local variable are not kept across a wait, use static variable or a context struct
+ * - a switch statement can not contain a wait
+ * A waiting coroutine is idle, it is run again when:
+ * - signaled, usually by the ISR of what it is waiting for (Custom_Coroutine_Wake)
+ * - after a delay, the task is rescheduled (with period 0) so it run once after it
+ * Every wait check its condition again when run, so an early wake up is harmless.
+ *
+ * void task(void *param)
+ * {
+ *     Coroutine_t *co = (Coroutine_t*) param;
+ *     CUSTOM_COROUTINE_BEGIN(co);
+ *     start_transfer(); // its ISR set done and call Custom_Coroutine_Wake(co)
+ *     CUSTOM_COROUTINE_WAIT_UNTIL(co, done);
+ *     CUSTOM_COROUTINE_DELAY_US(co, 1000);
+ *     CUSTOM_COROUTINE_END(co);
+ * }
+ *
+ * - CUSTOM_COROUTINE_WAIT_UNTIL(co, cond): return until cond is true
+ * - CUSTOM_COROUTINE_YIELD(co): let the other ready task run, resume right after
+ * - CUSTOM_COROUTINE_WAIT_DEADLINE(co, dl): wait until the deadline (SoftDeadline_t),
+ *   used for periodic work without drift (Custom_SoftTimer_DeadlineAdvance)
+ * - CUSTOM_COROUTINE_DELAY_US(co, us): wait for us from now
+ * Reaching CUSTOM_COROUTINE_END restart the coroutine from the beginning on its next
+ * run. Custom_Coroutine_Init() must be called with the task handle before the first
+ * signal, and again to restart it.
+ */
+
+typedef struct
+{
+    uint16_t line;             // where to resume, 0: from the beginning
+    SchedTask_Handle_t handle; // event task running the coroutine
+    SoftDeadline_t deadline;   // used by CUSTOM_COROUTINE_DELAY_US
+} Coroutine_t;
+
+static inline void Custom_Coroutine_Init(Coroutine_t *co, SchedTask_Handle_t handle)
+{
+    co->line = 0;
+    co->handle = handle;
+}
+
+// resume the coroutine, can be called from ISR
+static inline void Custom_Coroutine_Wake(Coroutine_t *co)
+{
+    if (co->handle != CUSTOM_SCHEDULER_HANDLE_NONE)
+    {
+        Custom_Scheduler_Signal(co->handle);
+    }
+}
+
+// run the task again once the deadline is reached (up to a tick late)
+static inline void Custom_Coroutine_SleepUntil(Coroutine_t *co, const SoftDeadline_t *dl)
+{
+    uint32_t tick_us = CUSTOM_SCHEDULER_TICK_DURATION_MS * 1000u;
+    uint32_t tick = (Custom_SoftTimer_DeadlineRemainingUs(dl) + tick_us - 1u) / tick_us;
+    Custom_Scheduler_Reschedule(co->handle, 0, tick);
+}
+
+#define CUSTOM_COROUTINE_BEGIN(co) switch ((co)->line) { case 0:
+
+#define CUSTOM_COROUTINE_END(co) } (co)->line = 0
+
+#define CUSTOM_COROUTINE_WAIT_UNTIL(co, cond) \
+    do { \
+        (co)->line = __LINE__; \
+        case __LINE__: \
+        if (!(cond)) \
+        { \
+            return; \
+        } \
+    } while (0)
+
+#define CUSTOM_COROUTINE_YIELD(co) \
+    do { \
+        (co)->line = __LINE__; \
+        Custom_Coroutine_Wake(co); \
+        return; \
+        case __LINE__:; \
+    } while (0)
+
+#define CUSTOM_COROUTINE_WAIT_DEADLINE(co, dl) \
+    do { \
+        (co)->line = __LINE__; \
+        case __LINE__: \
+        if (!Custom_SoftTimer_DeadlineIsExpired(dl)) \
+        { \
+            Custom_Coroutine_SleepUntil(co, dl); \
+            return; \
+        } \
+    } while (0)
+
+#define CUSTOM_COROUTINE_DELAY_US(co, us) \
+    do { \
+        Custom_SoftTimer_DeadlineSet(&(co)->deadline, us); \
+        CUSTOM_COROUTINE_WAIT_DEADLINE(co, &(co)->deadline); \
+    } while (0)
+
+#endif /* INC_CUSTOM_COROUTINE_H_ */
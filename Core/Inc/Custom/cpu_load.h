@@ -0,0 +1,79 @@
+/*
+ * cpu_load.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#ifndef INC_CUSTOM_CPU_LOAD_H_
+#define INC_CUSTOM_CPU_LOAD_H_
+
+#include "main.h"
+
+/*
+ * NOTE:
+ * CPU load meter
+ *
+ * Count the core cycle (DWT cycle counter) spent:
+ * - asleep, in the WFI at the end of each dispatch pass
+ * - running task (the time taken by ISR preempting a task is not counted in it)
+ * - in ISR (urgent task run from PendSV included, a nested ISR is counted once)
+ * The rest of the time is taken by the scheduler itself (and interrupt not measured).
+ *
+ * Each counter is a free running total written by a single context (sleep and task
+ * from the scheduler, ISR from the ISR), so no locking is needed. Every second (counted
+ * from the tick), the tick ISR store the cycle elapsed in the last second into a ring
+ * of CUSTOM_CPULOAD_WINDOW_S entry. The load over the last 1 s or 10 s is then the
+ * sum of the last 1 or 10 entry. A task running across the second boundary is counted
+ * in the second it end.
+ *
+ * - Custom_CpuLoad_Init(): enable the cycle counter
+ * - Custom_CpuLoad_TickUpdate(): must be called within the timer callback
+ * - Custom_CpuLoad_Get(): cycle spent over the last 1 to CUSTOM_CPULOAD_WINDOW_S second
+ * - Custom_CpuLoad_BusyPermille(): share of time not asleep, in 1/1000
+ *
+ * The scheduler and the ISR (in stm32f1xx_it.c) use the CUSTOM_CPULOAD_* macro, which
+ * are compiled out if CUSTOM_CPULOAD_ENABLE is not defined.
+ */
+
+#define CUSTOM_CPULOAD_ENABLE
+// number of second kept, the longest window that can be measured
+#define CUSTOM_CPULOAD_WINDOW_S (10u)
+
+typedef struct
+{
+    uint32_t total_cycle;
+    uint32_t sleep_cycle;
+    uint32_t task_cycle;
+    uint32_t isr_cycle;
+} CpuLoad_t;
+
+void Custom_CpuLoad_Init(void);
+void Custom_CpuLoad_TickUpdate(void);
+void Custom_CpuLoad_Get(uint8_t second, CpuLoad_t *load);
+uint16_t Custom_CpuLoad_BusyPermille(const CpuLoad_t *load);
+
+void Custom_CpuLoad_SleepBegin(void);
+void Custom_CpuLoad_SleepEnd(void);
+void Custom_CpuLoad_TaskBegin(void);
+void Custom_CpuLoad_TaskEnd(void);
+void Custom_CpuLoad_IsrEnter(void);
+void Custom_CpuLoad_IsrExit(void);
+
+#ifdef CUSTOM_CPULOAD_ENABLE
+#define CUSTOM_CPULOAD_SLEEP_BEGIN() Custom_CpuLoad_SleepBegin()
+#define CUSTOM_CPULOAD_SLEEP_END() Custom_CpuLoad_SleepEnd()
+#define CUSTOM_CPULOAD_TASK_BEGIN() Custom_CpuLoad_TaskBegin()
+#define CUSTOM_CPULOAD_TASK_END() Custom_CpuLoad_TaskEnd()
+#define CUSTOM_CPULOAD_ISR_ENTER() Custom_CpuLoad_IsrEnter()
+#define CUSTOM_CPULOAD_ISR_EXIT() Custom_CpuLoad_IsrExit()
+#else
+#define CUSTOM_CPULOAD_SLEEP_BEGIN() ((void) 0)
+#define CUSTOM_CPULOAD_SLEEP_END() ((void) 0)
+#define CUSTOM_CPULOAD_TASK_BEGIN() ((void) 0)
+#define CUSTOM_CPULOAD_TASK_END() ((void) 0)
+#define CUSTOM_CPULOAD_ISR_ENTER() ((void) 0)
+#define CUSTOM_CPULOAD_ISR_EXIT() ((void) 0)
+#endif
+
+#endif /* INC_CUSTOM_CPU_LOAD_H_ */
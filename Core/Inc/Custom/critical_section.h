@@ -0,0 +1,36 @@
+/*
+ * critical_section.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#ifndef INC_CUSTOM_CRITICAL_SECTION_H_
+#define INC_CUSTOM_CRITICAL_SECTION_H_
+
+#include "main.h"
+
+/*
+ * NOTE:
+ * Short critical section, used by module whose data is shared between task and
+ * ISR context. Interrupt are masked (PRIMASK) on enter, and the previous mask is
+ * restored on exit, so critical section can be nested and used from within ISR.
+ *
+ * uint32_t primask = Custom_Critical_Enter();
+ * ... (keep it short)
+ * Custom_Critical_Exit(primask);
+ */
+
+static inline uint32_t Custom_Critical_Enter(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+static inline void Custom_Critical_Exit(uint32_t primask)
+{
+    __set_PRIMASK(primask);
+}
+
+#endif /* INC_CUSTOM_CRITICAL_SECTION_H_ */
@@ -34,16 +34,22 @@ typedef enum
     ERR_PQUEUE_INVALIDCOUNT,
     ERR_PQUEUE_EMPTYPOP,
     ERR_PQUEUE_FULLINSERT,
+    ERR_PQUEUE_INVALIDHANDLE,
 
     ERR_SCHEDULER_FULLADD,
     ERR_SCHEDULER_EMPTYDELETE,
+    ERR_SCHEDULER_INVALIDHANDLE,
+    ERR_SCHEDULER_OVERLOAD,
+
+    ERR_POOL_EXHAUSTED,
+    ERR_POOL_INVALIDFREE,
 
     ERR_COUNT = 32, // the maximum value that this should have is 32
     ERR_ALL, // used to refer to all error bit
 } ErrCode_t;
 
 extern const char * const ERR_DESCRIPTION[ERR_COUNT];
-extern uint32_t err_bit;
+extern uint32_t volatile err_bit;
 
 void Custom_Err_SetStatus(ErrCode_t err);
 void Custom_Err_ClearStatus(ErrCode_t err);
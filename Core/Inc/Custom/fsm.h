@@ -10,6 +10,7 @@
 
 #include "main.h"
 #include "Custom/fsm_state_list.h"
+#include "Custom/scheduler_task.h"
 
 /**
  * NOTE:
@@ -46,4 +47,164 @@ FsmState_t Custom_Fsm_GetNextState(Fsm_t *fsm);
 void Custom_Fsm_SetNextState(Fsm_t *fsm);
 void Custom_Fsm_DoInState(Fsm_t *fsm);
 
+/**
+ * NOTE:
+ * Table-driven FSM
+ *
+ * Each machine define its own state enum and event enum (both starting from 0 and
+ * dense), and a constant FsmTable_t describing it. Since the table is const, it is
+ * placed in flash. The only RAM needed by each machine is its current state (one byte),
+ * so many small machine can share the same table and dispatch code.
+ *
+ * The table contain:
+ * - transition: a [state_count][event_count] array of FsmTableTransition_t, looked up
+ *   directly with (current state, event), so dispatching is O(1)
+ * - state: a [state_count] array of entry/exit hook (can be NULL if no state have hook)
+ *
+ * A transition entry can be:
+ * - empty (zero, left out from the initializer): the event is ignored within that state
+ * - FSM_TABLE_GOTO(next_state, action): run exit hook of current state, then the action,
+ *   then entry hook of the next state (also done when next_state is the current state)
+ * - FSM_TABLE_INTERNAL(action): only run the action, the state does not change
+ *
+ * Hook and action are given the context pointer passed to the dispatch function.
+ *
+ * Hierarchical state:
+ * A state can be nested in a parent state (FSM_TABLE_PARENT in its state entry), so
+ * behavior shared by several state is written once in the parent row. The current
+ * state is always the innermost one. On dispatch, if the current state does not
+ * handle the event, it bubble up to the parent, then the parent's parent, ...
+ * A transition from state S (the one handling the event) to state T exit every state
+ * from the current one up to (not including) the least common ancestor of S and T,
+ * run the action, then enter every state from there down to T. As in UML, a
+ * transition to self or to an ancestor/descendant exit and re-enter S.
+ * If T have nested state, FSM_TABLE_INITIAL in its state entry give the one entered
+ * by default, and so on until an innermost state is reached.
+ *
+ * The nesting depth is limited to FSM_TABLE_MAX_DEPTH, so dispatching is bounded by
+ * a constant (a few parent link per level) whatever the number of state.
+ * A flat machine simply leave parent and initial as zero.
+ *
+ * Example:
+ * static const FsmTableTransition_t transition[STATE_COUNT][EVENT_COUNT] =
+ * {
+ *     [STATE_IDLE][EVENT_START] = FSM_TABLE_GOTO(STATE_RUN, on_start),
+ *     [STATE_RUN][EVENT_STOP] = FSM_TABLE_GOTO(STATE_IDLE, NULL),
+ * };
+ * static const FsmTable_t table = FSM_TABLE(transition, NULL, STATE_IDLE);
+ *
+ * Example (hierarchical, STOP is handled by ON for both RUN and PAUSE):
+ * static const FsmTableStateHook_t state[STATE_COUNT] =
+ * {
+ *     [STATE_ON] = { .initial = FSM_TABLE_INITIAL(STATE_RUN) },
+ *     [STATE_RUN] = { .entry = run_entry, .parent = FSM_TABLE_PARENT(STATE_ON) },
+ *     [STATE_PAUSE] = { .parent = FSM_TABLE_PARENT(STATE_ON) },
+ * };
+ * static const FsmTableTransition_t transition[STATE_COUNT][EVENT_COUNT] =
+ * {
+ *     [STATE_IDLE][EVENT_START] = FSM_TABLE_GOTO(STATE_ON, NULL),
+ *     [STATE_ON][EVENT_STOP] = FSM_TABLE_GOTO(STATE_IDLE, NULL),
+ *     [STATE_RUN][EVENT_PAUSE] = FSM_TABLE_GOTO(STATE_PAUSE, NULL),
+ * };
+ */
+
+#ifndef FSM_TABLE_MAX_DEPTH
+#define FSM_TABLE_MAX_DEPTH (4u)
+#endif
+
+typedef uint8_t FsmTableState_t;
+typedef uint8_t FsmTableEvent_t;
+typedef void (*FsmTableHook_t)(void *ctx);
+
+typedef struct
+{
+    uint8_t target;           // 0: no transition, FSM_TABLE_TARGET_INTERNAL, or next state + 1
+    FsmTableHook_t action;    // run on transition, can be NULL
+} FsmTableTransition_t;
+
+typedef struct
+{
+    FsmTableHook_t entry;     // run when entering the state, can be NULL
+    FsmTableHook_t exit;      // run when leaving the state, can be NULL
+    uint8_t parent;           // 0: top level, or parent state + 1
+    uint8_t initial;          // 0: innermost state, or default nested state + 1
+} FsmTableStateHook_t;
+
+typedef struct
+{
+    const FsmTableTransition_t *transition; // [state_count][event_count]
+    const FsmTableStateHook_t *state;       // [state_count], can be NULL
+    uint8_t state_count;
+    uint8_t event_count;
+    FsmTableState_t initial_state;
+} FsmTable_t;
+
+#define FSM_TABLE_TARGET_NONE (0u)
+#define FSM_TABLE_TARGET_INTERNAL (0xFFu)
+#define FSM_TABLE_STATE_NONE (0xFFu)
+
+#define FSM_TABLE_GOTO(next_state, action_func) \
+    { .target = (uint8_t) ((next_state) + 1u), .action = (action_func) }
+#define FSM_TABLE_INTERNAL(action_func) \
+    { .target = FSM_TABLE_TARGET_INTERNAL, .action = (action_func) }
+#define FSM_TABLE_PARENT(parent_state) ((uint8_t) ((parent_state) + 1u))
+#define FSM_TABLE_INITIAL(nested_state) ((uint8_t) ((nested_state) + 1u))
+
+// build a FsmTable_t from a 2D transition array and (optionally) a state hook array
+#define FSM_TABLE(transition_array, state_hook_array, initial) \
+    { \
+        .transition = &(transition_array)[0][0], \
+        .state = (state_hook_array), \
+        .state_count = sizeof(transition_array) / sizeof((transition_array)[0]), \
+        .event_count = sizeof((transition_array)[0]) / sizeof((transition_array)[0][0]), \
+        .initial_state = (initial), \
+    }
+
+/**
+ * NOTE:
+ * - Custom_Fsm_TableInit: enter the initial state (and its parent and default nested
+ *   state), running their entry hook
+ * - Custom_Fsm_TableDispatch: process one event, return 1 if the event caused a
+ *   transition (or internal action) in the current state or one of its parent, 0 if
+ *   it was ignored
+ */
+
+void Custom_Fsm_TableInit(const FsmTable_t *table, FsmTableState_t *state, void *ctx);
+uint8_t Custom_Fsm_TableDispatch(const FsmTable_t *table, FsmTableState_t *state,
+        FsmTableEvent_t event, void *ctx);
+
+/**
+ * NOTE:
+ * Event-driven (active) FSM
+ *
+ * A table-driven machine can be given its own event queue and an event task within
+ * the scheduler. Event are posted to the machine (from task or ISR), which signal its
+ * task. The scheduler then run the machine only when it have pending event, in priority
+ * order with other machine and task. Each run process a single event to completion
+ * (run-to-completion), and signal the task again if more event are pending, so a higher
+ * priority machine can get in between.
+ *
+ * The event queue is a circular buffer, the array for it is provided by the user.
+ * Posting to a full queue drop the event (and set ERR_CIRBUFF_FULLINSERT).
+ *
+ * - Custom_Fsm_ActiveInit: enter the initial state, add the event task to scheduler
+ * - Custom_Fsm_Post: queue an event for the machine, can be called from ISR
+ */
+
+typedef struct
+{
+    const FsmTable_t *table;
+    void *ctx;                     // context passed to hook and action
+    FsmTableState_t state;
+    SchedTask_Handle_t task;       // event task running the machine
+    FsmTableEvent_t *queue;        // event queue (circular buffer)
+    size_t queue_size;
+    size_t queue_head;
+    size_t volatile queue_count;
+} FsmActive_t;
+
+void Custom_Fsm_ActiveInit(FsmActive_t *fsm, const FsmTable_t *table, void *ctx,
+        FsmTableEvent_t *queue, size_t queue_size, uint8_t priority, uint8_t ID);
+void Custom_Fsm_Post(FsmActive_t *fsm, FsmTableEvent_t event);
+
 #endif /* INC_FSM_H_ */
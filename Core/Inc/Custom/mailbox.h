@@ -0,0 +1,84 @@
+/*
+ * mailbox.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#ifndef INC_CUSTOM_MAILBOX_H_
+#define INC_CUSTOM_MAILBOX_H_
+
+#include "Custom/scheduler.h"
+#include "main.h"
+
+/*
+ * NOTE:
+ * Mailbox (message queue) between task, or from ISR to task.
+ *
+ * A mailbox hold up to capacity message of a fixed size, in a circular buffer provided
+ * by the user. Posting copy the message in, and signal the receiver task (an event task,
+ * see Custom_Scheduler_AddEvent), which is then run by the scheduler and take every
+ * message out. Posting to a full mailbox drop the message (and set
+ * ERR_CIRBUFF_FULLINSERT). Post can be called from ISR, a mailbox have a single
+ * receiver.
+ *
+ * Message are copied, so keep them small: a large payload is passed by reference, the
+ * message being a pointer to a block of the pool (Custom_Pool_Alloc, see Custom/pool.h)
+ * that the receiver free once done with it. Only the pointer is copied.
+ *
+ * - Custom_Mailbox_Init(): set the buffer and the message size, clear the statistic
+ * - Custom_Mailbox_SetReceiver(): task signaled on every post (HANDLE_NONE: none)
+ * - Custom_Mailbox_Post(): copy a message in, return 0 if it was dropped
+ * - Custom_Mailbox_Receive(): copy the oldest message out, return 0 if there is none
+ * - Custom_Mailbox_Count(): number of message waiting
+ * - Custom_Mailbox_GetStat(): number of message posted and dropped, highest depth
+ *
+ * CUSTOM_MAILBOX_DEFINE(name, type, capacity) define a mailbox of message of the given
+ * type (already initialized), with typed name_post() / name_receive() function, so
+ * the message type is checked by the compiler.
+ */
+
+typedef struct
+{
+    uint32_t posted;         // number of message posted (dropped included)
+    uint16_t dropped;        // number of message dropped because the mailbox was full
+    uint16_t maxDepth;       // highest number of message waiting at once
+} MailboxStat_t;
+
+typedef struct
+{
+    void *buffer;            // message array (circular buffer)
+    size_t msgSize;          // size of a message, in bytes
+    size_t capacity;         // number of message the buffer can hold
+    size_t head;
+    size_t volatile count;
+    SchedTask_Handle_t receiver; // task signaled on post
+    MailboxStat_t stat;
+} Mailbox_t;
+
+void Custom_Mailbox_Init(Mailbox_t *mb, void *buffer, size_t msg_size, size_t capacity);
+void Custom_Mailbox_SetReceiver(Mailbox_t *mb, SchedTask_Handle_t receiver);
+uint8_t Custom_Mailbox_Post(Mailbox_t *mb, const void *msg);
+uint8_t Custom_Mailbox_Receive(Mailbox_t *mb, void *msg);
+size_t Custom_Mailbox_Count(const Mailbox_t *mb);
+void Custom_Mailbox_GetStat(const Mailbox_t *mb, MailboxStat_t *stat);
+
+#define CUSTOM_MAILBOX_DEFINE(name, type, cap) \
+    static type name##_buffer[cap]; \
+    static Mailbox_t name = \
+    { \
+        .buffer = name##_buffer, \
+        .msgSize = sizeof(type), \
+        .capacity = (cap), \
+        .receiver = CUSTOM_SCHEDULER_HANDLE_NONE, \
+    }; \
+    static inline uint8_t name##_post(const type *msg) \
+    { \
+        return Custom_Mailbox_Post(&name, msg); \
+    } \
+    static inline uint8_t name##_receive(type *msg) \
+    { \
+        return Custom_Mailbox_Receive(&name, msg); \
+    }
+
+#endif /* INC_CUSTOM_MAILBOX_H_ */
@@ -0,0 +1,64 @@
+/*
+ * pool.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#ifndef INC_CUSTOM_POOL_H_
+#define INC_CUSTOM_POOL_H_
+
+#include "main.h"
+#include <stddef.h>
+
+/*
+ * NOTE:
+ * Fixed-block memory pool, used in place of malloc / free (the _sbrk heap is slow,
+ * fragment, and can not be used from ISR).
+ *
+ * The pool is split into size class, each a static array of block of the same size
+ * chained in a free list. Allocating take a block of the smallest class that fit the
+ * size (a larger class if it is empty), freeing put the block back into its class, so
+ * both are O(1) (bounded by the number of class) and never fragment. Both can be called
+ * from ISR: a block allocated by a task can be freed by an ISR (a transmit buffer
+ * freed on transmit complete), and the other way around.
+ *
+ * - Custom_Pool_Init(): build the free list, every block is free
+ * - Custom_Pool_Alloc(): return a block of at least size byte, NULL if there is none
+ *   (ERR_POOL_EXHAUSTED)
+ * - Custom_Pool_Free(): give a block back, freeing NULL do nothing, freeing a block
+ *   not allocated (or freed twice) set ERR_POOL_INVALIDFREE
+ * - Custom_Pool_BlockSize(): size of the block holding the pointer, 0 if none
+ * - Custom_Pool_GetStat(): block in use, highest number in use and allocation count of
+ *   a class, return 0 if there is no such class
+ *
+ * A block is aligned on 4 byte, its content is not cleared.
+ */
+
+// size class X(block size in byte, number of block), from the smallest, the size must
+// be a multiple of 4
+#define CUSTOM_POOL_CLASS_LIST(X) \
+    X(16, 8) \
+    X(32, 8) \
+    X(64, 4)
+
+#define CUSTOM_POOL_CLASS_ONE(size, count) + 1
+#define CUSTOM_POOL_CLASS_COUNT (0 CUSTOM_POOL_CLASS_LIST(CUSTOM_POOL_CLASS_ONE))
+
+typedef struct
+{
+    uint16_t blockSize;      // size of a block, in byte
+    uint16_t blockCount;     // number of block of the class
+    uint16_t used;           // number of block allocated
+    uint16_t maxUsed;        // highest number of block allocated at once
+    uint32_t alloc;          // number of block allocated from the class
+    uint16_t full;           // number of allocation that found the class empty
+} PoolStat_t;
+
+void Custom_Pool_Init(void);
+void *Custom_Pool_Alloc(size_t size);
+void Custom_Pool_Free(void *block);
+size_t Custom_Pool_BlockSize(const void *block);
+uint8_t Custom_Pool_GetStat(uint8_t class_index, PoolStat_t *stat);
+
+#endif /* INC_CUSTOM_POOL_H_ */
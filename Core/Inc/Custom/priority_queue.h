@@ -15,11 +15,46 @@
 // will be a max-queue
 typedef uint8_t (*Compare_function_t)(void*, void*);
 
+// arity of the heap (number of children per node), can be 2, 4 or 8
+// a higher arity give a shallower tree: insert (sift up) does less level,
+// while pop (sift down) does less level but more compare per level
+// it is the same for all heap within the system
+// 2 is chosen from the scheduler-shaped host benchmark (Host/Bench/bench_pqueue.c, best
+// of 5 run, ns per operation at n = 31 / 1023, arity 2 / 4 / 8):
+// - reload (periodic task run and sink back, pop heavy): 35 / 42 / 58, 66 / 71 / 103
+// - oneshot (one-shot task inserted near the top then popped): 69 / 51 / 67,
+//   162 / 108 / 101
+// the waiting heap mostly reload periodic task (event task do not go through it), and
+// the default size is 31, where arity 2 reload fastest; 4 suit a system with many
+// one-shot task
+#ifndef CUSTOM_PQUEUE_ARITY
+#define CUSTOM_PQUEUE_ARITY 2
+#endif
+
+#if (CUSTOM_PQUEUE_ARITY != 2) && (CUSTOM_PQUEUE_ARITY != 4) && (CUSTOM_PQUEUE_ARITY != 8)
+#error "CUSTOM_PQUEUE_ARITY must be 2, 4 or 8"
+#endif
+
+// handle (locator) of an element within an addressable heap
+typedef uint16_t PQueue_Handle_t;
+#define CUSTOM_PQUEUE_HANDLE_NONE ((uint16_t) 0xFFFFu)
+
+// locator for an addressable heap
+// - pos: array indexed by handle, pos[handle] is the current index of the element
+//   with that handle (or CUSTOM_PQUEUE_HANDLE_NONE if it is not in the heap)
+// - hoffset: offset (in bytes) of the PQueue_Handle_t field within each element
+typedef struct
+{
+    uint16_t *pos;
+    size_t hoffset;
+} PQueueLocator_t;
+
 /*
  * NOTE:
  * This module define function that work on a statically allocated priority
- * queue (binary heap). Whether it is max-heap or min-heap is not important,
- * since we will provide the comparison function between element.
+ * queue (d-ary heap, binary by default, see CUSTOM_PQUEUE_ARITY). Whether it is
+ * max-heap or min-heap is not important, since we will provide the comparison
+ * function between element.
  *
  * It is assumed that the array containing the heap already exists, and
  * we can access the top element of the heap at array[0]
@@ -30,6 +65,12 @@ typedef uint8_t (*Compare_function_t)(void*, void*);
  * - heap_pop: remove the top element of the heap
  * - heap_delete: remove the element at specified index
  * - heap_push_down: try to push down the element at the top
+ * - heap_insert_many: insert k element at once, either by k sift up or by
+ *   rebuilding the whole heap (Floyd method), whichever is cheaper
+ * - heap_pop_above: remove every element ranking strictly higher than a key
+ *   element, copy them (in no particular order) to an output array and return
+ *   their count. Few of them are popped from the top, otherwise the heap is
+ *   scanned in one pass and rebuilt
  *
  * This module is written with reuse in mind, so it is necessarily general
  * and unoptimized. Each function takes a slew of argument:
@@ -39,6 +80,26 @@ typedef uint8_t (*Compare_function_t)(void*, void*);
  * - current element count within array
  * - compare function
  * - pointer to the element to add (insert into head)
+ *
+ * The addressable variant (function with "Loc" in their name) additionally keep
+ * track of where every element is through a locator. Each element carries a
+ * handle (chosen by the user, unique within the heap, smaller than the size of
+ * the pos array), and every sift keeps loc->pos[handle] up to date. So an element
+ * can be reached in O(1) and re-positioned in O(log n) after its key changed:
+ * - loc_insert: insert a element, return its handle (the locator)
+ * - loc_update: the element key changed in any direction, re-position it
+ * - loc_increase_key: the element now ranks higher, sift it up only
+ * - loc_decrease_key: the element now ranks lower, sift it down only
+ * - loc_remove: remove the element with specified handle
+ * - loc_get: get the address of the element with specified handle
+ * Since handle belong to the user, an element keep its handle when it is removed
+ * and later inserted again (e.g. a periodic task being reloaded).
+ *
+ * None of the functions keep any state of their own (swapping goes through
+ * a small buffer on the stack), so they are reentrant and there is no limit
+ * on element size. Different heaps can be worked on concurrently from task
+ * and ISR context. Operations on the *same* heap from different contexts
+ * still have to be serialized by the user (e.g. by masking the interrupt).
  */
 
 void Custom_PQueue_Create(void *arr, size_t asize, size_t esize, size_t elemc,
@@ -51,5 +112,30 @@ void Custom_PQueue_Delete(void *arr, size_t asize, size_t esize, size_t elemc, s
         Compare_function_t cmp);
 void Custom_PQueue_PushDown(void *arr, size_t esize, size_t elemc,
         Compare_function_t cmp);
+void Custom_PQueue_InsertMany(void *arr, size_t asize, size_t esize, size_t elemc,
+        const void *elems, size_t k, Compare_function_t cmp);
+size_t Custom_PQueue_PopAbove(void *arr, size_t asize, size_t esize, size_t elemc,
+        void *key, void *out, Compare_function_t cmp);
+
+void Custom_PQueue_LocCreate(void *arr, size_t asize, size_t esize, size_t elemc,
+        const PQueueLocator_t *loc, Compare_function_t cmp);
+PQueue_Handle_t Custom_PQueue_LocInsert(void *arr, size_t asize, size_t esize, size_t elemc,
+        void *elem, const PQueueLocator_t *loc, Compare_function_t cmp);
+void Custom_PQueue_LocPop(void *arr, size_t asize, size_t esize, size_t elemc,
+        const PQueueLocator_t *loc, Compare_function_t cmp);
+void Custom_PQueue_LocRemove(void *arr, size_t asize, size_t esize, size_t elemc,
+        PQueue_Handle_t handle, const PQueueLocator_t *loc, Compare_function_t cmp);
+void *Custom_PQueue_LocGet(void *arr, size_t esize, size_t elemc,
+        PQueue_Handle_t handle, const PQueueLocator_t *loc);
+void Custom_PQueue_LocUpdate(void *arr, size_t esize, size_t elemc,
+        PQueue_Handle_t handle, const PQueueLocator_t *loc, Compare_function_t cmp);
+void Custom_PQueue_LocIncreaseKey(void *arr, size_t esize, size_t elemc,
+        PQueue_Handle_t handle, const PQueueLocator_t *loc, Compare_function_t cmp);
+void Custom_PQueue_LocDecreaseKey(void *arr, size_t esize, size_t elemc,
+        PQueue_Handle_t handle, const PQueueLocator_t *loc, Compare_function_t cmp);
+void Custom_PQueue_LocInsertMany(void *arr, size_t asize, size_t esize, size_t elemc,
+        const void *elems, size_t k, const PQueueLocator_t *loc, Compare_function_t cmp);
+size_t Custom_PQueue_LocPopAbove(void *arr, size_t asize, size_t esize, size_t elemc,
+        void *key, void *out, const PQueueLocator_t *loc, Compare_function_t cmp);
 
 #endif /* INC_CUSTOM_PRIORITY_QUEUE_H_ */
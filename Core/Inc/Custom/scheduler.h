@@ -33,14 +33,22 @@
  * until completion until finished. Only after that another can start running. Cooperative
  * policy opens the task to starvation.
  *
- * Each task is represented by a struct 'SchedTask_t', which will we stored in a
- * array representing a binary heap. The task have a runAtTick property to store the value
+ * Each task is represented by a struct 'SchedTask_t', stored in a slot array, and a
+ * small key 'SchedKey_t', which will we stored in a array representing a binary heap
+ * (see scheduler_task.h). The key have a runAtTick property to store the value
  * of tick that the task is scheduled to be run at.  Each task will take a function
  * pointer (with void * argument) and it is that function that will be called when
  * the task is run. Note that there is no counter within each task to count-down till
  * execute (but a system absolute timestamp (tick)).
  *
- * It is assumed the order established for the binary heap is provided by a comparison
+ * Two heap are used. Waiting task are kept in a heap ordered by runAtTick. On each
+ * dispatch pass, every task that is due is removed from it in one go (see
+ * Custom_PQueue_PopAbove) and put into a ready heap, ordered by priority. Ready task
+ * are then run highest priority first, and periodic task are put back into the waiting
+ * heap. So a high priority task that is not due yet will not hold back a lower priority
+ * task that is due.
+ *
+ * It is assumed the order established for the ready heap is provided by a comparison
  * function.
  *
  * The API for the scheduler have these function:
@@ -53,15 +61,139 @@
  *   This function add a 'SchedTask_t' struct within the priority queue (binary heap) and
  *   at the correct position. It takes various argument enough for establising a new task.
  *   Which is: task function pointer, argument pointer, priority value, period, delay (from
- *   scheduler start or from adding time) and task ID.
+ *   scheduler start or from adding time) and task ID. It returns the handle of the new
+ *   task (CUSTOM_SCHEDULER_HANDLE_NONE if the task can not be added).
+ * - Custom_Scheduler_AddEvent()
+ *   Add an event task. It is not scheduled by time, but stay idle until it is signaled.
+ *   Return the handle of the new task.
+ * - Custom_Scheduler_Signal()
+ *   Make the task with the provided handle ready to run in the next dispatch pass. This
+ *   can be called from ISR. A signaled event task run once, then go back to idle. A
+ *   signaled timed task is run right away, and its schedule restart from then.
+ *   Signaled task are run in priority order together with the task that are due.
  * - Custom_Scheduler_Delete()
  *   Remove a task from the priority queue, taking the task ID identifying the task to
  *   remove.
+ * - Custom_Scheduler_DeleteHandle()
+ *   Remove the task with the provided handle from the priority queue, in O(log n).
+ * - Custom_Scheduler_SetPriority()
+ *   Change the priority of the task with the provided handle, in O(log n).
+ * - Custom_Scheduler_Reschedule()
+ *   Change the period of the task with the provided handle, and schedule its next run
+ *   after the provided delay (from now), in O(log n).
+ * - Custom_Scheduler_SetOverrunPolicy()
+ *   Choose what happen when a periodic task run late enough to miss its next period
+ *   (see SchedOverrunPolicy_t): catching up can cause a burst of back-to-back run of a
+ *   slow task, starving the other, skip and coalesce bound it to a single run.
+ * - Custom_Scheduler_SetBudget()
+ *   Give a task an execution budget (in tick). The tick ISR count how long the running
+ *   task have been running, and when it exceed its budget, record it (see
+ *   SchedBudgetRecord_t) and take the action chosen: only log it, skip the next run of
+ *   the task (after it return), or reset the system. Since the record survive a reset,
+ *   a hung task can be identified afterward (Custom_Scheduler_GetBudgetRecord). When
+ *   the watchdog is used, the budget should be shorter than its timeout, so the action
+ *   is taken before the watchdog reset the system.
+ * - Custom_Scheduler_GetStat() / Custom_Scheduler_ClearStat()
+ *   Read / clear the lateness histogram and overrun count of a task (see
+ *   SchedTaskStat_t). Return 0 if the handle is not a task.
+ * - Custom_Scheduler_Chain()
+ *   Make the task 'next' the next stage of a task (CUSTOM_SCHEDULER_HANDLE_NONE: no next
+ *   stage), to build a pipeline (sample -> filter -> format -> transmit). The next stage
+ *   is usually an event task, it is the next stage of one task at most (chaining it
+ *   again replace the previous link).
+ * - Custom_Scheduler_Output()
+ *   Called by the running task (from the dispatch, not from ISR), to hand a pointer to
+ *   its output to the next stage. When the task return, the next stage is made ready
+ *   in the same dispatch pass (run in priority order with the other ready task), with
+ *   no signal and no polling.
+ * - Custom_Scheduler_GetInput()
+ *   Called by the running task, take the pointer handed by the previous stage (NULL if
+ *   there is none, or it was taken already). The data is not copied: the producer must
+ *   not change it until the next stage is done with it (use a buffer per output in
+ *   flight). A stage that did not take its input before the next one is handed only
+ *   get the latest.
+ * - Custom_Scheduler_SetCost()
+ *   Declare the execution time of a task (in us), used to spread the phase.
+ * - Custom_Scheduler_SpreadPhase()
+ *   Task with harmonic period added with the same delay are all released on the same
+ *   tick, so that tick take the whole load. This give every periodic task waiting for
+ *   its next run a new phase (first run within one period from the next tick), placing
+ *   the heaviest first where it keep the peak load per tick lowest (over the next
+ *   CUSTOM_SCHEDULER_PHASE_HORIZON tick). The weight of a task is its declared cost, or
+ *   its longest run measured: call it before Custom_Scheduler_Init() with declared cost,
+ *   or again later (from a task) once the run time are measured. Task ready or running
+ *   at that time keep their phase. Do not use it for task which phase matter.
+ * - Custom_Scheduler_GetPhaseReport()
+ *   Read the load per tick before and after the last spread (return 0 if never spread).
+ * - Custom_Scheduler_GetPhaseLoad()
+ *   Compute the current load per tick over the horizon, and optionally copy it (the
+ *   profile must hold CUSTOM_SCHEDULER_PHASE_HORIZON entry).
+ * - Custom_Scheduler_AddEdf() / Custom_Scheduler_SetDeadline() /
+ *   Custom_Scheduler_GetUtilization() (EDF policy only)
+ *   See below.
  * - Custom_Scheduler_Dispatch()
  *   This function is intended to be called within the super loop, it will determined the
  *   next task to be run and run it. After finishing all task that are need to be run, it
  *   put the uC into sleep state until the system is wake up again by regular timer
  *   interrupt.
+ *
+ * EDF policy (if CUSTOM_SCHEDULER_POLICY_EDF is defined, in scheduler_task.h):
+ * Due task are ordered by absolute deadline (release + relative deadline), the earliest
+ * first, priority only break tie. A periodic task added with Custom_Scheduler_Add() get
+ * its period as deadline, other task a deadline of 0 (run as soon as possible once
+ * released or signaled), Custom_Scheduler_SetDeadline() change it.
+ * - Custom_Scheduler_AddEdf()
+ *   Add a periodic task with its relative deadline (in tick, 0: the period) and worst
+ *   case execution time (in us). Admission control: the task is rejected (with
+ *   ERR_SCHEDULER_OVERLOAD) if the density sum (wcet / min(deadline, period)) of the
+ *   task admitted this way would exceed 100%. Task added otherwise are not accounted.
+ *   The task set stay schedulable only if the execution time hold, and since task are
+ *   not preempted, a task can also be held back by the longest other task running
+ *   (leave some margin for it).
+ *   For a task added this way, Custom_Scheduler_SetDeadline() and
+ *   Custom_Scheduler_Reschedule() run the admission again with the new deadline or
+ *   period (the deadline is clamped to the period): a change that does not fit, or a
+ *   period of 0, is rejected with ERR_SCHEDULER_OVERLOAD and the task left unchanged.
+ * - Custom_Scheduler_GetUtilization()
+ *   Density sum of the admitted task, in part per million.
+ *
+ * Urgent band (if CUSTOM_SCHEDULER_USE_URGENT_BAND is defined):
+ * A few task can be added to an urgent band instead. They are not run by the dispatch
+ * loop, but from the PendSV handler, set to the lowest interrupt priority: an urgent
+ * task preempt whatever cooperative task is running (so its latency does not depend on
+ * how long the other task run), but never an ISR. Urgent task run to completion among
+ * themselves, highest priority first.
+ * An urgent task run in handler mode, so it follow the same rule as an ISR: it must
+ * only use ISR safe function (Custom_Scheduler_Signal, trace, timestamp, ...), and data
+ * shared with cooperative task must be protected by a critical section. Time spent in
+ * it is counted as ISR time by the CPU load meter, and toward the budget of the
+ * cooperative task it preempted.
+ * - Custom_Scheduler_AddUrgent()
+ *   Add an urgent task, released every period tick (counted from when it is added) by
+ *   the tick ISR, or only when signaled if the period is 0. Urgent handle come after the
+ *   regular one, so Custom_Scheduler_Signal() and Custom_Scheduler_DeleteHandle() take
+ *   both (the other function only take regular handle).
+ * - Custom_Scheduler_RunUrgent()
+ *   Run every released urgent task, must be called within the PendSV handler.
+ * - Custom_Scheduler_GetUrgentStat()
+ *   Read the number of run, worst latency (release to start, in us) and overrun (released
+ *   again before it ran) of an urgent task.
+ *
+ * Cyclic executive mode (if CUSTOM_SCHEDULER_USE_CYCLIC is defined):
+ * For a fixed, harmonic set of periodic task, known at build time. Tools/cyclic_gen.py
+ * turn the task set (Tools/cyclic_taskset.json) into a static table of minor frame
+ * (sched_cyclic_table, in scheduler_cyclic_table.c), checked for feasibility when
+ * generated and again at compile time. The tick ISR only count the minor frame due,
+ * and the dispatch run the task of the next frame straight from the table, before the
+ * task of the heap: no heap operation, the dispatch overhead of the table is constant.
+ * A frame due while the previous one is still running is skipped (frame stay aligned
+ * with the tick), and counted.
+ * The task of the table must not be added with Custom_Scheduler_Add(), and are not
+ * handled by the other function (they have no handle). Event task, and task added at
+ * run time, are run from the heap as usual after the frame.
+ * - Custom_Scheduler_GetCyclicStat()
+ *   Read the number of frame run and skipped, and the longest frame (in us), to check
+ *   the estimated execution time of the task set.
  */
 
 // config for hardware watchdog timer
@@ -77,18 +209,47 @@
 #define CUSTOM_SCHEDULER_TICK_DURATION_MS 10
 
 // config for the priority queue (binary heap)
+// this is also the maximum number of task, each task take 16 bytes (slot) + 8 bytes (key
+// in waiting heap) + 8 bytes (key in ready heap) + 6 bytes (locator and handle) + 30 bytes
+// (statistic) + 8 bytes (chaining), the EDF policy add 4 bytes to the slot and each
+// key, and 4 bytes of admitted density
 // default to setting the size equal to a complete binary tree of depth n
 // though different size value is okay, it is recommended to set size to 2^n - 1
+// (the heap arity is set by CUSTOM_PQUEUE_ARITY in priority_queue.h, the size does
+// not need to be a complete tree for other arity)
+#ifndef CUSTOM_SCHEDULER_BIHEAP_HEIGHT
 #define CUSTOM_SCHEDULER_BIHEAP_HEIGHT 5
+#endif
 #define CUSTOM_SCHEDULER_BIHEAP_SIZE ((1u << CUSTOM_SCHEDULER_BIHEAP_HEIGHT) - 1)
 
+// config for the urgent band
+// PendSV is used exclusively, CUSTOM_SCHEDULER_URGENT_SIZE is the maximum number of
+// urgent task
+#undef CUSTOM_SCHEDULER_USE_URGENT_BAND
+#define CUSTOM_SCHEDULER_URGENT_SIZE 4
+#define CUSTOM_SCHEDULER_URGENT_NVIC_PRIORITY 15
+#define CUSTOM_SCHEDULER_IS_URGENT_HANDLE(handle) ((handle) >= CUSTOM_SCHEDULER_BIHEAP_SIZE \
+        && (handle) < CUSTOM_SCHEDULER_BIHEAP_SIZE + CUSTOM_SCHEDULER_URGENT_SIZE)
+
+// config for the cyclic executive mode
+// the table is generated by Tools/cyclic_gen.py, regenerate it when the task set change
+#undef CUSTOM_SCHEDULER_USE_CYCLIC
+
+// number of tick looked ahead to spread the phase of periodic task, the result is exact
+// if it is a multiple of every period (4 bytes of RAM per tick)
+#define CUSTOM_SCHEDULER_PHASE_HORIZON 100
+
+// overrun policy given to new task
+#define CUSTOM_SCHEDULER_DEFAULT_OVERRUN_POLICY SCHED_OVERRUN_SKIP
+
 // defining the ordering between task (comparison function)
+// it is used to order the task that are due (ready) within a dispatch pass
 //
 // this function have a default implementation (weak), user can overwrite that
 // and implement a custom function within user code
 //
 // NOTE: must return true (1) if task1 < task2 to create a max heap in which
-// task2 ranks higher than task1
+// task2 ranks higher than task1, both argument point to SchedKey_t
 uint8_t Custom_SchedTask_Compare_Smaller(void* task1, void *task2);
 
 // time conversion macro
@@ -100,9 +261,45 @@ uint8_t Custom_SchedTask_Compare_Smaller(void* task1, void *task2);
 // prototype for scheduler API
 void Custom_Scheduler_Init(void);
 void Custom_Scheduler_Update(void);
-void Custom_Scheduler_Add(SchedTask_Func_t pTask, void *pArg,
+SchedTask_Handle_t Custom_Scheduler_Add(SchedTask_Func_t pTask, void *pArg,
         uint8_t priority, uint32_t period, uint32_t delay, uint8_t ID);
+SchedTask_Handle_t Custom_Scheduler_AddEvent(SchedTask_Func_t pTask, void *pArg,
+        uint8_t priority, uint8_t ID);
+void Custom_Scheduler_Signal(SchedTask_Handle_t handle);
 void Custom_Scheduler_Delete(uint8_t ID);
+void Custom_Scheduler_DeleteHandle(SchedTask_Handle_t handle);
+void Custom_Scheduler_SetPriority(SchedTask_Handle_t handle, uint8_t priority);
+void Custom_Scheduler_Reschedule(SchedTask_Handle_t handle, uint32_t period, uint32_t delay);
+void Custom_Scheduler_SetOverrunPolicy(SchedTask_Handle_t handle, SchedOverrunPolicy_t policy);
+uint8_t Custom_Scheduler_GetStat(SchedTask_Handle_t handle, SchedTaskStat_t *stat);
+void Custom_Scheduler_ClearStat(SchedTask_Handle_t handle);
+void Custom_Scheduler_Chain(SchedTask_Handle_t handle, SchedTask_Handle_t next);
+void Custom_Scheduler_Output(void *data);
+void *Custom_Scheduler_GetInput(void);
+void Custom_Scheduler_SetCost(SchedTask_Handle_t handle, uint16_t cost_us);
+void Custom_Scheduler_SpreadPhase(void);
+uint8_t Custom_Scheduler_GetPhaseReport(SchedPhaseReport_t *report);
+void Custom_Scheduler_GetPhaseLoad(SchedPhaseLoad_t *load, uint32_t *profile);
+void Custom_Scheduler_SetBudget(SchedTask_Handle_t handle, uint16_t budget_tick,
+        SchedBudgetAction_t action);
+uint8_t Custom_Scheduler_GetBudgetRecord(SchedBudgetRecord_t *record);
+void Custom_Scheduler_ClearBudgetRecord(void);
 void Custom_Scheduler_Dispatch();
+#ifdef CUSTOM_SCHEDULER_POLICY_EDF
+SchedTask_Handle_t Custom_Scheduler_AddEdf(SchedTask_Func_t pTask, void *pArg,
+        uint32_t period, uint32_t deadline, uint32_t wcet_us, uint8_t ID);
+void Custom_Scheduler_SetDeadline(SchedTask_Handle_t handle, uint32_t deadline);
+uint32_t Custom_Scheduler_GetUtilization(void);
+#endif
+#ifdef CUSTOM_SCHEDULER_USE_URGENT_BAND
+SchedTask_Handle_t Custom_Scheduler_AddUrgent(SchedTask_Func_t pTask, void *pArg,
+        uint8_t priority, uint32_t period, uint8_t ID);
+void Custom_Scheduler_RunUrgent(void);
+uint8_t Custom_Scheduler_GetUrgentStat(SchedTask_Handle_t handle, SchedUrgentStat_t *stat);
+#endif
+#ifdef CUSTOM_SCHEDULER_USE_CYCLIC
+extern const SchedCyclicTable_t sched_cyclic_table;
+void Custom_Scheduler_GetCyclicStat(SchedCyclicStat_t *stat);
+#endif
 
 #endif /* INC_CUSTOM_SCHEDULER_H_ */
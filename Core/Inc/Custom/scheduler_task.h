@@ -9,6 +9,7 @@
 #define INC_CUSTOM_SCHEDULER_TASK_H_
 
 #include "main.h"
+#include "Custom/priority_queue.h"
 
 /*
  * NOTE:
@@ -19,21 +20,205 @@ typedef void (*SchedTask_Func_t)(void*);
 
 /*
  * NOTE:
- * The scheduler_task_t is a structure containing all the required infomation
- * to represent a task in our scheduler implemetation
+ * Each task within the scheduler is given a handle when added, which stay the same
+ * for the whole lifetime of the task (even when it moves around within the heap).
+ * The handle is used as the locator into the addressable heap of the scheduler.
+ */
+typedef PQueue_Handle_t SchedTask_Handle_t;
+#define CUSTOM_SCHEDULER_HANDLE_NONE CUSTOM_PQUEUE_HANDLE_NONE
+
+/*
+ * NOTE:
+ * A task is split into two part, so that moving task around within the heap is cheap:
+ * - SchedTask_t (cold part) contain everything only needed when the task is run.
+ *   It is stored within a slot array, and never moved. The slot index is the task
+ *   handle.
+ * - SchedKey_t (hot part) contain only what is needed to order the task (runAtTick,
+ *   priority) and the slot index. Only the key is stored within the heap, so a heap
+ *   move copy 8 bytes.
  *
  * The priority of a test is determined as according to a rule: compare by priority,
  * then compare by runAtTick next
+ * With the EDF policy, the key also carry the relative deadline of the task (the
+ * absolute deadline is runAtTick + deadlineTick), and is 12 bytes.
  */
+
+// config for the scheduling policy (here since it change the key layout)
+// when defined, due task are ordered by absolute deadline (earliest deadline first)
+// instead of by priority, see Custom_Scheduler_AddEdf in scheduler.h
+#undef CUSTOM_SCHEDULER_POLICY_EDF
+
 typedef struct
 {
-    SchedTask_Func_t pTask;  // function pointer
+    SchedTask_Func_t pTask;  // function pointer, NULL if the slot is free
     void *pTaskArg;          // argument for task
-    uint8_t priority;        // priority for task
-    uint32_t runAtTick;      // scheduled to be run at tick
     uint32_t periodTick;     // period for auto-reload task, 0 if not auto-reload
     uint8_t taskID;          // used to identify task
+    uint8_t priority;        // priority for task (copy kept for idle event task)
+    uint8_t isEvent;         // event task, stay idle (instead of deleted) when not scheduled
+    volatile uint8_t isSignaled; // signal pending, set from Custom_Scheduler_Signal
+#ifdef CUSTOM_SCHEDULER_POLICY_EDF
+    uint32_t deadlineTick;   // relative deadline, from release (copy kept for idle event task)
+#endif
 } SchedTask_t;
 
+typedef struct
+{
+    uint32_t runAtTick;      // scheduled to be run at tick
+    SchedTask_Handle_t slot; // index of the task within the slot array (handle)
+    uint8_t priority;        // priority for task
+    uint8_t reserved;
+#ifdef CUSTOM_SCHEDULER_POLICY_EDF
+    uint32_t deadlineTick;   // relative deadline, from runAtTick
+#endif
+} SchedKey_t;
+
+#ifdef CUSTOM_SCHEDULER_POLICY_EDF
+_Static_assert(sizeof(SchedKey_t) == 12, "SchedKey_t is expected to be 12 bytes");
+#else
+_Static_assert(sizeof(SchedKey_t) == 8, "SchedKey_t is expected to be 8 bytes");
+#endif
+
+/*
+ * NOTE:
+ * Timing statistic of a task, kept in a separate array (indexed by handle) since it
+ * is only touched once per run.
+ * - lateness: number of run by how late (in tick) the task started, bucket i count the
+ *   run started 2^(i-1) to 2^i - 1 tick late (bucket 0: on time), the last bucket count
+ *   everything above
+ * - overrun: number of run of a periodic task that ended after its next period began
+ * - skipped: number of period not run, because of the overrun policy (or budget action)
+ * - budget_tick / budget_action: execution budget of the task (0: none), see
+ *   Custom_Scheduler_SetBudget
+ * - over_budget: number of run that exceeded the budget
+ * - cost_us: declared execution time of the task (0: none), see Custom_Scheduler_SetCost
+ * - max_run_us: longest run measured
+ * Counter (and max_run_us) stop at UINT16_MAX.
+ */
+#define CUSTOM_SCHEDULER_LATENESS_BUCKET 8
+
+typedef enum
+{
+    SCHED_OVERRUN_CATCH_UP,  // run every missed period, back-to-back
+    SCHED_OVERRUN_SKIP,      // drop the missed period, run at the next aligned period
+    SCHED_OVERRUN_COALESCE,  // run once right away for all missed period, restart from there
+} SchedOverrunPolicy_t;
+
+typedef enum
+{
+    SCHED_BUDGET_LOG,        // only record the task
+    SCHED_BUDGET_SKIP,       // record the task, skip its next run
+    SCHED_BUDGET_RESET,      // record the task, reset the system right away
+} SchedBudgetAction_t;
+
+typedef struct
+{
+    uint16_t lateness[CUSTOM_SCHEDULER_LATENESS_BUCKET];
+    uint16_t overrun;
+    uint16_t skipped;
+    uint16_t budget_tick;
+    uint16_t over_budget;
+    uint16_t cost_us;
+    uint16_t max_run_us;
+    uint8_t policy;          // SchedOverrunPolicy_t
+    uint8_t budget_action;   // SchedBudgetAction_t
+} SchedTaskStat_t;
+
+/*
+ * NOTE:
+ * Record of the last task that exceeded its budget. It is placed in RAM not
+ * initialized at startup (.noinit), so it can still be read after a reset.
+ */
+typedef struct
+{
+    uint32_t magic;          // CUSTOM_SCHEDULER_BUDGET_MAGIC if the record is valid
+    uint32_t tick;           // tick at which the budget was exceeded
+    uint32_t count;          // number of time any budget was exceeded since recorded
+    SchedTask_Handle_t handle;
+    uint8_t taskID;
+    uint8_t action;          // SchedBudgetAction_t taken
+} SchedBudgetRecord_t;
+
+#define CUSTOM_SCHEDULER_BUDGET_MAGIC (0xB0D6E7EDu)
+
+/*
+ * NOTE:
+ * Task of the urgent band (see scheduler.h), kept in a small array scanned by priority.
+ * countdownTick is decremented by the tick ISR, the task is released when it reach 0.
+ */
+typedef struct
+{
+    SchedTask_Func_t pTask;  // function pointer, NULL if the entry is free
+    void *pTaskArg;          // argument for task
+    uint32_t periodTick;     // release period, 0 if only released when signaled
+    uint32_t countdownTick;  // tick till the next release
+    uint32_t releaseUs;      // time of the last release
+    uint8_t taskID;          // used to identify task
+    uint8_t priority;        // order among urgent task, higher run first
+    volatile uint8_t isReleased; // released, waiting to be run
+} SchedUrgentTask_t;
+
+typedef struct
+{
+    uint32_t run;            // number of run
+    uint32_t maxLatencyUs;   // worst time from release to start
+    uint16_t overrun;        // number of release while the previous one was not run yet
+} SchedUrgentStat_t;
+
+/*
+ * NOTE:
+ * Static schedule table of the cyclic executive mode, generated by Tools/cyclic_gen.py.
+ * The major frame is split into frameCount minor frame of minorTick tick each. Minor
+ * frame i run entry[frame[i].first] to entry[frame[i].first + frame[i].count - 1], in
+ * order.
+ */
+typedef struct
+{
+    SchedTask_Func_t pTask;  // function pointer
+    void *pTaskArg;          // argument for task
+    uint8_t taskID;          // used to identify task
+} SchedCyclicEntry_t;
+
+typedef struct
+{
+    uint16_t first;          // index of the first entry of the frame
+    uint16_t count;          // number of entry in the frame
+} SchedCyclicFrame_t;
+
+typedef struct
+{
+    uint32_t minorTick;      // length of a minor frame, in tick
+    uint16_t frameCount;     // number of minor frame in the major frame
+    const SchedCyclicFrame_t *frame;
+    const SchedCyclicEntry_t *entry;
+} SchedCyclicTable_t;
+
+typedef struct
+{
+    uint32_t frame;          // number of minor frame run
+    uint32_t maxFrameUs;     // longest time taken to run a minor frame
+    uint16_t skipped;        // number of minor frame not run, because the previous overran
+} SchedCyclicStat_t;
+
+/*
+ * NOTE:
+ * Load of the periodic task released on each tick of the phase horizon (see
+ * Custom_Scheduler_SpreadPhase), a task weight its declared cost, else its longest run
+ * measured, else 1 us. Tick are counted from the start of the horizon.
+ */
+typedef struct
+{
+    uint32_t peakUs;         // highest load of a tick
+    uint32_t totalUs;        // load over the whole horizon
+    uint16_t peakTick;       // first tick with the highest load
+    uint16_t busyTick;       // number of tick with at least a task released
+} SchedPhaseLoad_t;
+
+typedef struct
+{
+    SchedPhaseLoad_t before; // load before the last spread
+    SchedPhaseLoad_t after;  // load right after it
+    uint16_t moved;          // number of task given a new phase
+} SchedPhaseReport_t;
 
 #endif /* INC_CUSTOM_SCHEDULER_TASK_H_ */
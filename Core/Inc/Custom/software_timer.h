@@ -28,4 +28,93 @@ void Custom_SoftTimer_SetDurationTick(volatile SoftTimer_t *tm, uint32_t ms);
 void Custom_SoftTimer_TickUpdate(volatile SoftTimer_t *tm);
 uint8_t Custom_SoftTimer_IsSet(volatile SoftTimer_t *tm);
 
+/**
+ * NOTE:
+ * Timer service
+ *
+ * SoftTimer_t above need one Custom_SoftTimer_TickUpdate call per timer per tick. The
+ * timer service instead keep every started timer in a hashed timing wheel: an array of
+ * CUSTOM_SOFTTIMER_WHEEL_SIZE slot, each one a (intrusive, doubly linked) list of the
+ * timer expiring at a tick equal to the slot index modulo the wheel size.
+ *
+ * - Custom_SoftTimer_ServiceTick() is called in the tick ISR, it only increment the
+ *   wheel tick and signal the service task if the slot of that tick is not empty, so it
+ *   cost the same whatever the number of timer.
+ * - The service task (an event task of the scheduler) go through the slot of every tick
+ *   elapsed since its last run, and fire the timer that are due in it. Timer expiring
+ *   after more than one turn of the wheel stay in their slot.
+ * - Start / stop / restart link or unlink a single timer, there is no scan.
+ *
+ * When a timer fire, its flag is set (read and cleared by Custom_SoftTimer_IsExpired)
+ * and its callback (if not NULL) is called from the service task. A periodic timer is
+ * started again for its next period before the callback, missed period (if the service
+ * task is late) are skipped.
+ *
+ * The timer struct is provided by the user, must be zero initialized before its first
+ * use (as static variable are) and must stay valid while the timer is started. Except
+ * for Custom_SoftTimer_ServiceTick and Custom_SoftTimer_IsExpired, the API must not be
+ * called from ISR.
+ */
+
+// must be a power of 2, a timer expiring within this many tick is checked once
+#define CUSTOM_SOFTTIMER_WHEEL_SIZE (64u)
+#define CUSTOM_SOFTTIMER_SERVICE_PRIORITY (2u)
+#define CUSTOM_SOFTTIMER_SERVICE_ID (126u)
+
+typedef void (*SoftTimer_Callback_t)(void *arg);
+
+typedef enum
+{
+	TIMER_STATE_IDLE, TIMER_STATE_ARMED, TIMER_STATE_FIRING,
+} SoftTimerEntry_State_t;
+
+typedef struct SoftTimerEntry
+{
+	struct SoftTimerEntry *next;        // within the wheel slot
+	struct SoftTimerEntry *prev;
+	struct SoftTimerEntry *fire_next;   // within the list of timer being fired
+	uint32_t expire_tick;
+	uint32_t period_tick;               // 0 for one-shot
+	uint32_t delay_tick;                // first delay, used by restart
+	SoftTimer_Callback_t callback;
+	void *arg;
+	SoftTimerEntry_State_t state;
+	volatile uint8_t flag;
+} SoftTimerEntry_t;
+
+void Custom_SoftTimer_ServiceInit(void);
+void Custom_SoftTimer_ServiceTick(void);
+void Custom_SoftTimer_Start(SoftTimerEntry_t *tm, uint32_t delay_tick, uint32_t period_tick,
+		SoftTimer_Callback_t callback, void *arg);
+void Custom_SoftTimer_Stop(SoftTimerEntry_t *tm);
+void Custom_SoftTimer_Restart(SoftTimerEntry_t *tm);
+uint8_t Custom_SoftTimer_IsExpired(SoftTimerEntry_t *tm);
+
+/**
+ * NOTE:
+ * Deadline timer
+ *
+ * A deadline timer only store the absolute time (in us, from Custom_Timestamp_GetUs)
+ * at which it expire. There is no per-tick work at all, checking it is a single
+ * compare against the clock, and its resolution is 1 us instead of a tick.
+ *
+ * - Custom_SoftTimer_DeadlineSet: expire us from now
+ * - Custom_SoftTimer_DeadlineAdvance: expire us after the previous deadline, used for
+ *   periodic timing without drift
+ * - Custom_SoftTimer_DeadlineIsExpired: 1 if the deadline is reached
+ * - Custom_SoftTimer_DeadlineRemainingUs: time left till the deadline, 0 if reached
+ *
+ * The duration must be less than 2^31 us (~35 minutes).
+ */
+
+typedef struct
+{
+	uint32_t deadline_us;
+} SoftDeadline_t;
+
+void Custom_SoftTimer_DeadlineSet(SoftDeadline_t *dl, uint32_t us);
+void Custom_SoftTimer_DeadlineAdvance(SoftDeadline_t *dl, uint32_t us);
+uint8_t Custom_SoftTimer_DeadlineIsExpired(const SoftDeadline_t *dl);
+uint32_t Custom_SoftTimer_DeadlineRemainingUs(const SoftDeadline_t *dl);
+
 #endif /* INC_SOFTWARE_TIMER_H_ */
@@ -0,0 +1,59 @@
+/*
+ * timestamp.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#ifndef INC_CUSTOM_TIMESTAMP_H_
+#define INC_CUSTOM_TIMESTAMP_H_
+
+#include "main.h"
+#include "Custom/scheduler.h"
+
+/*
+ * NOTE:
+ * Monotonic clock with microsecond resolution, 64 bit so it never wrap around.
+ *
+ * By default, the regular timer of the scheduler (timer 3) count at 1 MHz and overflow
+ * every tick (see tim.c). The clock is the number of tick elapsed (counted by this
+ * module) times the tick duration, plus the timer counter value, so it does not need
+ * any other hardware.
+ * Reading the count and the counter is not atomic: the counter may overflow in between,
+ * or may have overflowed while the tick ISR is not yet run (reading from another ISR, or
+ * with interrupt disabled). So both are read with interrupt masked, and if the timer
+ * update flag is pending, the counter is read again and the missing tick is added.
+ * This assume that no ISR preempt the timer ISR (all interrupt have the same preemption
+ * priority in this project).
+ *
+ * If CUSTOM_TIMESTAMP_USE_DWT is defined, the DWT cycle counter is used instead (1 cycle
+ * resolution, no dependency on the timer counter). It is 32 bit and wrap around every
+ * ~67 s at 64 MHz, so its upper half is extended in software, on every read and on every
+ * tick (so at least once per wrap).
+ *
+ * - Custom_Timestamp_Init() must be called before reading the clock
+ * - Custom_Timestamp_TickUpdate() must be called within the timer callback, next to
+ *   Custom_Scheduler_Update
+ * - Custom_Timestamp_GetUs64() return the time in us
+ * - Custom_Timestamp_GetUs() return the lower 32 bit of it, cheaper to store and enough for
+ *   duration (compare with (int32_t) (a - b) instead of a < b, it wrap around every ~71
+ *   minutes)
+ * Reading the clock can be done from both task and ISR.
+ */
+
+// the timer driving the clock, counting at CUSTOM_TIMESTAMP_COUNTER_HZ and overflowing
+// every CUSTOM_SCHEDULER_TICK_DURATION_MS
+#define CUSTOM_TIMESTAMP_TIMER htim3
+#define CUSTOM_TIMESTAMP_COUNTER_HZ 1000000u
+#define CUSTOM_TIMESTAMP_TICK_US (CUSTOM_SCHEDULER_TICK_DURATION_MS * 1000u)
+
+// config for the DWT cycle counter, core clock in cycle per us
+#undef CUSTOM_TIMESTAMP_USE_DWT
+#define CUSTOM_TIMESTAMP_DWT_CYCLE_PER_US 64u
+
+void Custom_Timestamp_Init(void);
+void Custom_Timestamp_TickUpdate(void);
+uint64_t Custom_Timestamp_GetUs64(void);
+uint32_t Custom_Timestamp_GetUs(void);
+
+#endif /* INC_CUSTOM_TIMESTAMP_H_ */
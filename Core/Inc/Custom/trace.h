@@ -0,0 +1,82 @@
+/*
+ * trace.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#ifndef INC_CUSTOM_TRACE_H_
+#define INC_CUSTOM_TRACE_H_
+
+#include "main.h"
+
+/*
+ * NOTE:
+ * Binary event trace
+ *
+ * Event are recorded as fixed size record (timestamp in us, event ID, two argument)
+ * into a RAM ring, which is dumped over UART. The scheduler (task start / end, add,
+ * delete), the ISR (TIM3, USART2, ADC) and user code record event with the CUSTOM_TRACE
+ * macro. Recording can be done from both task and ISR, without masking interrupt: the
+ * slot is reserved by incrementing the ring head with LDREX/STREX (retried if an ISR
+ * recorded in between), then filled. It cost a few tens of cycle, mostly reading the
+ * clock. When the ring is full, the oldest record are overwritten.
+ *
+ * The ring is dumped by an event task, a few record per run so that it does not hold
+ * the scheduler for long. A dump is started by Custom_Trace_Dump (the "!TRC#" command),
+ * or, if CUSTOM_TRACE_DUMP_WHEN_IDLE is defined, every time the scheduler is idle and
+ * there are at least CUSTOM_TRACE_DUMP_CHUNK new record. Only the record not dumped yet
+ * are sent, a dump after the ring have wrapped around start with a TRACE_EVENT_LOST
+ * record (arg1: record lost).
+ *
+ * Record are sent in frame, so they can be picked out from the other UART output:
+ * 0xA5 0x5A, record count (1 byte), the record (12 byte each, little endian), checksum
+ * (sum of the record byte, 1 byte). See Tools/trace_decode.py to turn a dump into a
+ * timeline.
+ *
+ * If CUSTOM_TRACE_ENABLE is not defined, CUSTOM_TRACE is compiled out.
+ */
+
+#define CUSTOM_TRACE_ENABLE
+#undef CUSTOM_TRACE_DUMP_WHEN_IDLE
+
+// number of record in the ring, must be a power of 2
+#define CUSTOM_TRACE_SIZE (64u)
+// number of record sent per run of the dump task
+#define CUSTOM_TRACE_DUMP_CHUNK (8u)
+#define CUSTOM_TRACE_DUMP_PRIORITY (0u)
+#define CUSTOM_TRACE_DUMP_ID (127u)
+
+typedef enum
+{
+    TRACE_EVENT_LOST = 0,          // arg1: number of record overwritten before dump
+    TRACE_EVENT_TASK_START = 1,    // arg0: task handle, arg1: task ID
+    TRACE_EVENT_TASK_END = 2,      // arg0: task handle, arg1: task ID
+    TRACE_EVENT_TASK_ADD = 3,      // arg0: task handle, arg1: task ID
+    TRACE_EVENT_TASK_DELETE = 4,   // arg0: task handle, arg1: task ID
+    TRACE_EVENT_ISR_ENTER = 5,     // arg0: IRQ number
+    TRACE_EVENT_ISR_EXIT = 6,      // arg0: IRQ number
+    TRACE_EVENT_USER = 0x100,      // user event ID start from here
+} TraceEvent_t;
+
+typedef struct
+{
+    uint32_t timestamp;            // lower 32 bit of Custom_Timestamp_GetUs64
+    uint16_t event;
+    uint16_t arg0;
+    uint32_t arg1;
+} TraceRecord_t;
+
+void Custom_Trace_Init(void);
+void Custom_Trace_Record(uint16_t event, uint16_t arg0, uint32_t arg1);
+void Custom_Trace_Dump(void);
+void Custom_Trace_Idle(void);
+
+#ifdef CUSTOM_TRACE_ENABLE
+#define CUSTOM_TRACE(event, arg0, arg1) \
+    Custom_Trace_Record((uint16_t) (event), (uint16_t) (arg0), (uint32_t) (arg1))
+#else
+#define CUSTOM_TRACE(event, arg0, arg1) ((void) 0)
+#endif
+
+#endif /* INC_CUSTOM_TRACE_H_ */
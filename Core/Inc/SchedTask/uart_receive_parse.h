@@ -8,9 +8,15 @@
 #ifndef INC_SCHEDTASK_UART_RECEIVE_PARSE_H_
 #define INC_SCHEDTASK_UART_RECEIVE_PARSE_H_
 
+#include "Custom/mailbox.h"
+
 #define BUFFER_SIZE 10
 
+#define TASK_RECEIVE_ID (124u)
+#define TASK_COMMAND_ID (125u)
+
 void uart_receive_init(void);
 void uart_receive_parse(void *param);
+void uart_receive_get_stat(MailboxStat_t *stat);
 
 #endif /* INC_SCHEDTASK_UART_RECEIVE_PARSE_H_ */
@@ -8,8 +8,24 @@
 #ifndef INC_SCHEDTASK_UART_SEND_RESPONSE_H_
 #define INC_SCHEDTASK_UART_SEND_RESPONSE_H_
 
+#include "Custom/scheduler.h"
+
 #define TASK_SEND_ID (123u)
+#define TASK_STATUS_ID (122u)
+#define TASK_SAMPLE_ID (121u)
 
+void uart_send_init(void);
+// pipeline sending the ADC value periodically, each stage is a coroutine (param is its
+// Coroutine_t): the first read the ADC periodically, the next send the value read
+void uart_send_sample(void *param);
 void uart_send_response(void *param);
+// start / stop sending the ADC value every period_ms, start return the handle of the
+// task sending it
+SchedTask_Handle_t uart_send_start(uint32_t period_ms);
+void uart_send_stop(void);
+// send the CPU load over the last 1 s and 10 s, the last task over budget, and the
+// lateness of every task (event task, run it with uart_send_status_request)
+void uart_send_status(void *param);
+void uart_send_status_request(void);
 
 #endif /* INC_SCHEDTASK_UART_SEND_RESPONSE_H_ */
@@ -0,0 +1,158 @@
+/*
+ * cpu_load.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#include "Custom/cpu_load.h"
+#include "Custom/critical_section.h"
+#include "Custom/scheduler.h"
+
+#define TICK_PER_SECOND (1000u / CUSTOM_SCHEDULER_TICK_DURATION_MS)
+
+// free running total, in cycle
+static uint32_t volatile sleep_total = 0;
+static uint32_t volatile task_total = 0;
+static uint32_t volatile isr_total = 0;
+
+// start of the current sleep / task / ISR
+static uint32_t sleep_start;
+static uint32_t task_start;
+static uint32_t task_start_isr_total;
+static uint32_t isr_start;
+// number of ISR nested, only the outermost one is timed
+static uint8_t isr_depth = 0;
+
+// cycle spent in each of the last second, window[window_index] is the latest one
+static CpuLoad_t window[CUSTOM_CPULOAD_WINDOW_S];
+static uint8_t window_index = 0;
+static uint8_t window_filled = 0;
+static CpuLoad_t last_total;
+static uint16_t tick_count = 0;
+
+void Custom_CpuLoad_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    sleep_total = 0;
+    task_total = 0;
+    isr_total = 0;
+    window_index = 0;
+    window_filled = 0;
+    tick_count = 0;
+    last_total.total_cycle = DWT->CYCCNT;
+    last_total.sleep_cycle = 0;
+    last_total.task_cycle = 0;
+    last_total.isr_cycle = 0;
+}
+
+void Custom_CpuLoad_TickUpdate(void)
+{
+    tick_count++;
+    if (tick_count < TICK_PER_SECOND)
+    {
+        return;
+    }
+    tick_count = 0;
+
+    // close the current second
+    CpuLoad_t now =
+    {
+        .total_cycle = DWT->CYCCNT,
+        .sleep_cycle = sleep_total,
+        .task_cycle = task_total,
+        .isr_cycle = isr_total,
+    };
+    window_index = (window_index + 1u) % CUSTOM_CPULOAD_WINDOW_S;
+    window[window_index].total_cycle = now.total_cycle - last_total.total_cycle;
+    window[window_index].sleep_cycle = now.sleep_cycle - last_total.sleep_cycle;
+    window[window_index].task_cycle = now.task_cycle - last_total.task_cycle;
+    window[window_index].isr_cycle = now.isr_cycle - last_total.isr_cycle;
+    last_total = now;
+    if (window_filled < CUSTOM_CPULOAD_WINDOW_S)
+    {
+        window_filled++;
+    }
+}
+
+void Custom_CpuLoad_Get(uint8_t second, CpuLoad_t *load)
+{
+    load->total_cycle = 0;
+    load->sleep_cycle = 0;
+    load->task_cycle = 0;
+    load->isr_cycle = 0;
+
+    // the tick ISR may close a second while reading
+    uint32_t primask = Custom_Critical_Enter();
+    if (second > window_filled)
+    {
+        second = window_filled;
+    }
+    for (uint8_t i = 0; i < second; i++)
+    {
+        const CpuLoad_t *w = &window[(window_index + CUSTOM_CPULOAD_WINDOW_S - i)
+                % CUSTOM_CPULOAD_WINDOW_S];
+        load->total_cycle += w->total_cycle;
+        load->sleep_cycle += w->sleep_cycle;
+        load->task_cycle += w->task_cycle;
+        load->isr_cycle += w->isr_cycle;
+    }
+    Custom_Critical_Exit(primask);
+}
+
+uint16_t Custom_CpuLoad_BusyPermille(const CpuLoad_t *load)
+{
+    if (load->total_cycle == 0)
+    {
+        return 0;
+    }
+    uint32_t busy = load->total_cycle - load->sleep_cycle;
+    return (uint16_t) (((uint64_t) busy * 1000u) / load->total_cycle);
+}
+
+// called with interrupt masked (see enter_sleep in scheduler.c)
+void Custom_CpuLoad_SleepBegin(void)
+{
+    sleep_start = DWT->CYCCNT;
+}
+
+void Custom_CpuLoad_SleepEnd(void)
+{
+    sleep_total += DWT->CYCCNT - sleep_start;
+}
+
+// the cycle counter is read outside of the ISR total on both end, so an ISR in between
+// can only be counted in the task (and not make the task time negative)
+void Custom_CpuLoad_TaskBegin(void)
+{
+    task_start = DWT->CYCCNT;
+    task_start_isr_total = isr_total;
+}
+
+void Custom_CpuLoad_TaskEnd(void)
+{
+    uint32_t isr_elapsed = isr_total - task_start_isr_total;
+    uint32_t elapsed = DWT->CYCCNT - task_start;
+    // take out the time spent in ISR while the task was running
+    task_total += elapsed - isr_elapsed;
+}
+
+// the peripheral ISR do not nest, but they can preempt the urgent band (PendSV), a
+// nested ISR always exit before the one it preempted so the depth stay consistent
+void Custom_CpuLoad_IsrEnter(void)
+{
+    if (isr_depth++ == 0)
+    {
+        isr_start = DWT->CYCCNT;
+    }
+}
+
+void Custom_CpuLoad_IsrExit(void)
+{
+    if (--isr_depth == 0)
+    {
+        isr_total += DWT->CYCCNT - isr_start;
+    }
+}
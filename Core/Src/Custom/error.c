@@ -6,8 +6,9 @@
  */
 
 #include "Custom/error.h"
+#include "Custom/critical_section.h"
 
-uint32_t err_bit = 0;
+uint32_t volatile err_bit = 0;
 
 const char * const ERR_DESCRIPTION[ERR_COUNT] =
 {
@@ -18,35 +19,47 @@ const char * const ERR_DESCRIPTION[ERR_COUNT] =
     [ERR_PQUEUE_INVALIDCOUNT] = "Invalid element count for priority queue provided",
     [ERR_PQUEUE_EMPTYPOP] = "Popping empty priority queue",
     [ERR_PQUEUE_FULLINSERT] = "Inserting into full priority queue",
+    [ERR_PQUEUE_INVALIDHANDLE] = "Using a handle not within the priority queue",
     [ERR_SCHEDULER_EMPTYDELETE] = "Delete task when the task list is empty",
     [ERR_SCHEDULER_FULLADD] = "Add task when the task list is full",
+    [ERR_SCHEDULER_INVALIDHANDLE] = "Using a handle of a task not within the scheduler",
+    [ERR_SCHEDULER_OVERLOAD] = "Add task that would exceed the schedulable utilization",
+    [ERR_POOL_EXHAUSTED] = "Allocate from the pool when no block is large enough",
+    [ERR_POOL_INVALIDFREE] = "Free a block not allocated from the pool",
 };
 
 static inline
 uint32_t get_error_bit_mask(ErrCode_t err)
 {
     if (err != ERR_ALL)
-        return 1u < err;
+        return 1u << err;
     else
         return 0xFFFFFFFF;
 }
 
+// err_bit can be changed from both task and ISR context (every module
+// report error through here), so the read-modify-write is done with
+// interrupt masked
 void Custom_Err_SetStatus(ErrCode_t err)
 {
     uint32_t error_bit_mask = get_error_bit_mask(err);
+    uint32_t primask = Custom_Critical_Enter();
     err_bit |= error_bit_mask;
+    Custom_Critical_Exit(primask);
 }
 
 void Custom_Err_ClearStatus(ErrCode_t err)
 {
     uint32_t error_bit_mask = get_error_bit_mask(err);
+    uint32_t primask = Custom_Critical_Enter();
     err_bit &= ~error_bit_mask;
+    Custom_Critical_Exit(primask);
 }
 
 uint8_t Custom_Err_CheckStatus(ErrCode_t err)
 {
     uint32_t error_bit_mask = get_error_bit_mask(err);
-    return (err_bit & ~error_bit_mask) != 0;
+    return (err_bit & error_bit_mask) != 0;
 }
 
 // user can redefine this if needed
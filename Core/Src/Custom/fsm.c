@@ -6,6 +6,9 @@
  */
 
 #include "Custom/fsm.h"
+#include "Custom/circular_buffer.h"
+#include "Custom/critical_section.h"
+#include "Custom/scheduler.h"
 
 FsmState_t Custom_Fsm_GetNextState(Fsm_t *fsm)
 {
@@ -15,7 +18,7 @@ FsmState_t Custom_Fsm_GetNextState(Fsm_t *fsm)
 void Custom_Fsm_SetNextState(Fsm_t *fsm)
 {
     FsmState_t next_state = Custom_Fsm_GetNextState(fsm);
-    if (fsm->set_next_state == NULL)
+    if (fsm->set_next_state != NULL)
     {
         fsm->set_next_state(next_state);
     }
@@ -24,8 +27,204 @@ void Custom_Fsm_SetNextState(Fsm_t *fsm)
 
 void Custom_Fsm_DoInState(Fsm_t *fsm)
 {
-    if (fsm->do_in_state == NULL)
+    if (fsm->do_in_state != NULL)
     {
         fsm->do_in_state();
     }
 }
+
+static inline void run_hook(FsmTableHook_t hook, void *ctx)
+{
+    if (hook != NULL)
+    {
+        hook(ctx);
+    }
+}
+
+static inline FsmTableState_t get_parent(const FsmTable_t *table, FsmTableState_t state)
+{
+    if (table->state == NULL || table->state[state].parent == 0)
+    {
+        return FSM_TABLE_STATE_NONE;
+    }
+    return table->state[state].parent - 1u;
+}
+
+static uint8_t get_depth(const FsmTable_t *table, FsmTableState_t state)
+{
+    uint8_t depth = 0;
+    while (depth < FSM_TABLE_MAX_DEPTH
+            && (state = get_parent(table, state)) != FSM_TABLE_STATE_NONE)
+    {
+        depth++;
+    }
+    return depth;
+}
+
+// least common ancestor of a and b, which is not a or b itself (FSM_TABLE_STATE_NONE
+// if they do not share one)
+static FsmTableState_t get_transition_ancestor(const FsmTable_t *table, FsmTableState_t a,
+        FsmTableState_t b)
+{
+    uint8_t depth_a = get_depth(table, a);
+    uint8_t depth_b = get_depth(table, b);
+    FsmTableState_t lca_a = a;
+    FsmTableState_t lca_b = b;
+
+    for (; depth_a > depth_b; depth_a--)
+    {
+        lca_a = get_parent(table, lca_a);
+    }
+    for (; depth_b > depth_a; depth_b--)
+    {
+        lca_b = get_parent(table, lca_b);
+    }
+    for (uint8_t depth = 0; lca_a != lca_b && depth <= FSM_TABLE_MAX_DEPTH; depth++)
+    {
+        lca_a = get_parent(table, lca_a);
+        lca_b = get_parent(table, lca_b);
+    }
+
+    if (lca_a == a || lca_a == b)
+    {
+        // transition to self, ancestor or descendant: exit and re-enter
+        lca_a = get_parent(table, lca_a);
+    }
+    return lca_a;
+}
+
+// enter every state from ancestor (excluded) down to target, then the default
+// nested state of target until an innermost state, return that state
+static FsmTableState_t enter_state(const FsmTable_t *table, FsmTableState_t ancestor,
+        FsmTableState_t target, void *ctx)
+{
+    if (table->state == NULL)
+    {
+        return target;
+    }
+
+    FsmTableState_t path[FSM_TABLE_MAX_DEPTH + 1];
+    uint8_t path_len = 0;
+    for (FsmTableState_t s = target; s != ancestor && path_len <= FSM_TABLE_MAX_DEPTH;
+            s = get_parent(table, s))
+    {
+        path[path_len++] = s;
+    }
+    while (path_len > 0)
+    {
+        run_hook(table->state[path[--path_len]].entry, ctx);
+    }
+
+    for (uint8_t depth = 0; depth < FSM_TABLE_MAX_DEPTH && table->state[target].initial != 0;
+            depth++)
+    {
+        target = table->state[target].initial - 1u;
+        run_hook(table->state[target].entry, ctx);
+    }
+    return target;
+}
+
+void Custom_Fsm_TableInit(const FsmTable_t *table, FsmTableState_t *state, void *ctx)
+{
+    *state = enter_state(table, FSM_TABLE_STATE_NONE, table->initial_state, ctx);
+}
+
+uint8_t Custom_Fsm_TableDispatch(const FsmTable_t *table, FsmTableState_t *state,
+        FsmTableEvent_t event, void *ctx)
+{
+    if (*state >= table->state_count || event >= table->event_count)
+    {
+        return 0;
+    }
+
+    // find the innermost state handling the event
+    const FsmTableTransition_t *transition;
+    FsmTableState_t source = *state;
+    for (uint8_t depth = 0;; depth++)
+    {
+        transition = &table->transition[(size_t) source * table->event_count + event];
+        if (transition->target != FSM_TABLE_TARGET_NONE)
+        {
+            break;
+        }
+        source = get_parent(table, source);
+        if (source == FSM_TABLE_STATE_NONE || depth >= FSM_TABLE_MAX_DEPTH)
+        {
+            return 0; // event ignored within this state and its parent
+        }
+    }
+
+    if (transition->target == FSM_TABLE_TARGET_INTERNAL)
+    {
+        run_hook(transition->action, ctx);
+        return 1;
+    }
+
+    FsmTableState_t next_state = transition->target - 1u;
+    if (table->state == NULL)
+    {
+        run_hook(transition->action, ctx);
+        *state = next_state;
+        return 1;
+    }
+
+    FsmTableState_t ancestor = get_transition_ancestor(table, source, next_state);
+    FsmTableState_t s = *state;
+    for (uint8_t depth = 0; s != ancestor && s != FSM_TABLE_STATE_NONE
+            && depth <= FSM_TABLE_MAX_DEPTH; depth++)
+    {
+        run_hook(table->state[s].exit, ctx);
+        s = get_parent(table, s);
+    }
+    run_hook(transition->action, ctx);
+    *state = enter_state(table, ancestor, next_state, ctx);
+
+    return 1;
+}
+
+// event task of an active machine, process one pending event
+static void fsm_active_run(void *param)
+{
+    FsmActive_t *fsm = (FsmActive_t*) param;
+
+    uint32_t primask = Custom_Critical_Enter();
+    if (fsm->queue_count == 0)
+    {
+        Custom_Critical_Exit(primask);
+        return;
+    }
+    FsmTableEvent_t event = fsm->queue[fsm->queue_head];
+    Custom_CirBuff_Delete(fsm->queue_size, &fsm->queue_head, (size_t*) &fsm->queue_count);
+    uint8_t more_pending = (fsm->queue_count > 0);
+    Custom_Critical_Exit(primask);
+
+    Custom_Fsm_TableDispatch(fsm->table, &fsm->state, event, fsm->ctx);
+
+    if (more_pending)
+    {
+        Custom_Scheduler_Signal(fsm->task);
+    }
+}
+
+void Custom_Fsm_ActiveInit(FsmActive_t *fsm, const FsmTable_t *table, void *ctx,
+        FsmTableEvent_t *queue, size_t queue_size, uint8_t priority, uint8_t ID)
+{
+    fsm->table = table;
+    fsm->ctx = ctx;
+    fsm->queue = queue;
+    fsm->queue_size = queue_size;
+    fsm->queue_head = 0;
+    fsm->queue_count = 0;
+    Custom_Fsm_TableInit(table, &fsm->state, ctx);
+    fsm->task = Custom_Scheduler_AddEvent(fsm_active_run, fsm, priority, ID);
+}
+
+void Custom_Fsm_Post(FsmActive_t *fsm, FsmTableEvent_t event)
+{
+    uint32_t primask = Custom_Critical_Enter();
+    Custom_CirBuff_Insert(fsm->queue, fsm->queue_size, sizeof(FsmTableEvent_t),
+            &fsm->queue_head, (size_t*) &fsm->queue_count, &event);
+    Custom_Critical_Exit(primask);
+
+    Custom_Scheduler_Signal(fsm->task);
+}
@@ -0,0 +1,87 @@
+/*
+ * mailbox.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#include "Custom/mailbox.h"
+#include "Custom/circular_buffer.h"
+#include "Custom/critical_section.h"
+#include <string.h>
+
+void Custom_Mailbox_Init(Mailbox_t *mb, void *buffer, size_t msg_size, size_t capacity)
+{
+    mb->buffer = buffer;
+    mb->msgSize = msg_size;
+    mb->capacity = capacity;
+    mb->head = 0;
+    mb->count = 0;
+    mb->receiver = CUSTOM_SCHEDULER_HANDLE_NONE;
+    memset(&mb->stat, 0, sizeof(MailboxStat_t));
+}
+
+void Custom_Mailbox_SetReceiver(Mailbox_t *mb, SchedTask_Handle_t receiver)
+{
+    mb->receiver = receiver;
+}
+
+// can be called from ISR
+uint8_t Custom_Mailbox_Post(Mailbox_t *mb, const void *msg)
+{
+    uint8_t is_posted = 0;
+    uint32_t primask = Custom_Critical_Enter();
+    mb->stat.posted++;
+    if (mb->count < mb->capacity)
+    {
+        Custom_CirBuff_Insert(mb->buffer, mb->capacity, mb->msgSize, &mb->head,
+                (size_t*) &mb->count, (void*) msg);
+        if (mb->count > mb->stat.maxDepth)
+        {
+            mb->stat.maxDepth = (uint16_t) mb->count;
+        }
+        is_posted = 1;
+    }
+    else
+    {
+        if (mb->stat.dropped < UINT16_MAX)
+        {
+            mb->stat.dropped++;
+        }
+        Custom_Err_SetStatus(ERR_CIRBUFF_FULLINSERT);
+    }
+    Custom_Critical_Exit(primask);
+
+    // the receiver is signaled even when full, so it keep taking message out
+    if (mb->receiver != CUSTOM_SCHEDULER_HANDLE_NONE)
+    {
+        Custom_Scheduler_Signal(mb->receiver);
+    }
+    return is_posted;
+}
+
+uint8_t Custom_Mailbox_Receive(Mailbox_t *mb, void *msg)
+{
+    uint32_t primask = Custom_Critical_Enter();
+    if (mb->count == 0)
+    {
+        Custom_Critical_Exit(primask);
+        return 0;
+    }
+    memcpy(msg, (uint8_t*) mb->buffer + mb->head * mb->msgSize, mb->msgSize);
+    Custom_CirBuff_Delete(mb->capacity, &mb->head, (size_t*) &mb->count);
+    Custom_Critical_Exit(primask);
+    return 1;
+}
+
+size_t Custom_Mailbox_Count(const Mailbox_t *mb)
+{
+    return mb->count;
+}
+
+void Custom_Mailbox_GetStat(const Mailbox_t *mb, MailboxStat_t *stat)
+{
+    uint32_t primask = Custom_Critical_Enter();
+    *stat = mb->stat;
+    Custom_Critical_Exit(primask);
+}
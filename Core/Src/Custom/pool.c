@@ -0,0 +1,186 @@
+/*
+ * pool.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#include "Custom/pool.h"
+#include "Custom/critical_section.h"
+#include "Custom/error.h"
+#include <string.h>
+
+#define POOL_CLASS_CHECK(size, count) \
+    _Static_assert((size) % sizeof(uint32_t) == 0 && (size) >= sizeof(void*), \
+            "pool block size must be a multiple of 4"); \
+    _Static_assert((count) > 0 && (count) <= UINT16_MAX, "invalid pool block count");
+#define POOL_CLASS_WORD(size, count) + ((size) / sizeof(uint32_t)) * (count)
+#define POOL_CLASS_BLOCK(size, count) + (count)
+#define POOL_CLASS_CONFIG(size, count) { (size), (count) },
+
+CUSTOM_POOL_CLASS_LIST(POOL_CLASS_CHECK)
+
+#define POOL_WORD_COUNT (0 CUSTOM_POOL_CLASS_LIST(POOL_CLASS_WORD))
+#define POOL_BLOCK_COUNT (0 CUSTOM_POOL_CLASS_LIST(POOL_CLASS_BLOCK))
+
+typedef struct PoolBlock
+{
+    struct PoolBlock *next;  // next free block of the class
+} PoolBlock_t;
+
+typedef struct
+{
+    uint8_t *base;           // first block of the class
+    uint8_t *end;            // past the last block
+    uint16_t first;          // index of the first block in pool_used
+    PoolBlock_t *free;       // free list
+    PoolStat_t stat;
+} PoolClass_t;
+
+static const uint16_t class_config[CUSTOM_POOL_CLASS_COUNT][2] =
+{
+    CUSTOM_POOL_CLASS_LIST(POOL_CLASS_CONFIG)
+};
+
+static uint32_t pool_storage[POOL_WORD_COUNT];
+// one bit per block, set while allocated (catch a block freed twice)
+static uint32_t pool_used[(POOL_BLOCK_COUNT + 31u) / 32u];
+static PoolClass_t pool_class[CUSTOM_POOL_CLASS_COUNT];
+
+static inline uint16_t block_index(const PoolClass_t *c, const uint8_t *block)
+{
+    return c->first + (uint16_t) ((size_t) (block - c->base) / c->stat.blockSize);
+}
+
+static uint8_t find_class(const uint8_t *block)
+{
+    for (uint8_t i = 0; i < CUSTOM_POOL_CLASS_COUNT; i++)
+    {
+        if (block >= pool_class[i].base && block < pool_class[i].end)
+        {
+            return i;
+        }
+    }
+    return CUSTOM_POOL_CLASS_COUNT;
+}
+
+void Custom_Pool_Init(void)
+{
+    uint8_t *base = (uint8_t*) pool_storage;
+    uint16_t first = 0;
+    for (uint8_t i = 0; i < CUSTOM_POOL_CLASS_COUNT; i++)
+    {
+        PoolClass_t *c = &pool_class[i];
+        uint16_t size = class_config[i][0];
+        uint16_t count = class_config[i][1];
+        c->base = base;
+        c->end = base + (size_t) size * count;
+        c->first = first;
+        c->free = NULL;
+        // chained from the last, so the block are allocated in address order
+        for (uint16_t j = count; j > 0; j--)
+        {
+            PoolBlock_t *block = (PoolBlock_t*) (base + (size_t) (j - 1u) * size);
+            block->next = c->free;
+            c->free = block;
+        }
+        memset(&c->stat, 0, sizeof(PoolStat_t));
+        c->stat.blockSize = size;
+        c->stat.blockCount = count;
+        base = c->end;
+        first += count;
+    }
+    memset(pool_used, 0, sizeof(pool_used));
+}
+
+// can be called from ISR
+void *Custom_Pool_Alloc(size_t size)
+{
+    uint32_t primask = Custom_Critical_Enter();
+    for (uint8_t i = 0; i < CUSTOM_POOL_CLASS_COUNT; i++)
+    {
+        PoolClass_t *c = &pool_class[i];
+        if (c->stat.blockSize < size)
+        {
+            continue;
+        }
+        if (c->free == NULL)
+        {
+            // try the next larger class
+            if (c->stat.full < UINT16_MAX)
+            {
+                c->stat.full++;
+            }
+            continue;
+        }
+
+        PoolBlock_t *block = c->free;
+        c->free = block->next;
+        uint16_t index = block_index(c, (uint8_t*) block);
+        pool_used[index / 32u] |= 1ul << (index % 32u);
+        c->stat.used++;
+        if (c->stat.used > c->stat.maxUsed)
+        {
+            c->stat.maxUsed = c->stat.used;
+        }
+        c->stat.alloc++;
+        Custom_Critical_Exit(primask);
+        return block;
+    }
+    Custom_Critical_Exit(primask);
+
+    Custom_Err_SetStatus(ERR_POOL_EXHAUSTED);
+    return NULL;
+}
+
+// can be called from ISR
+void Custom_Pool_Free(void *block)
+{
+    if (block == NULL)
+    {
+        return;
+    }
+
+    uint8_t i = find_class((uint8_t*) block);
+    if (i >= CUSTOM_POOL_CLASS_COUNT
+            || (size_t) ((uint8_t*) block - pool_class[i].base) % pool_class[i].stat.blockSize)
+    {
+        Custom_Err_SetStatus(ERR_POOL_INVALIDFREE);
+        return;
+    }
+
+    PoolClass_t *c = &pool_class[i];
+    uint16_t index = block_index(c, (uint8_t*) block);
+    uint32_t mask = 1ul << (index % 32u);
+    uint32_t primask = Custom_Critical_Enter();
+    if ((pool_used[index / 32u] & mask) == 0)
+    {
+        // already free
+        Custom_Critical_Exit(primask);
+        Custom_Err_SetStatus(ERR_POOL_INVALIDFREE);
+        return;
+    }
+    pool_used[index / 32u] &= ~mask;
+    ((PoolBlock_t*) block)->next = c->free;
+    c->free = (PoolBlock_t*) block;
+    c->stat.used--;
+    Custom_Critical_Exit(primask);
+}
+
+size_t Custom_Pool_BlockSize(const void *block)
+{
+    uint8_t i = find_class((const uint8_t*) block);
+    return (i < CUSTOM_POOL_CLASS_COUNT) ? pool_class[i].stat.blockSize : 0;
+}
+
+uint8_t Custom_Pool_GetStat(uint8_t class_index, PoolStat_t *stat)
+{
+    if (class_index >= CUSTOM_POOL_CLASS_COUNT)
+    {
+        return 0;
+    }
+    uint32_t primask = Custom_Critical_Enter();
+    *stat = pool_class[class_index].stat;
+    Custom_Critical_Exit(primask);
+    return 1;
+}
@@ -9,44 +9,90 @@
 #include "Custom/error.h"
 #include <string.h>
 
-// create a temp mem (used for swapping)
-// the size is arbitrarily set (must be bigger than the size of
-// elements we are swapping.
-// also try to allocate aligned by 4 bytes
-#define MAX_TEMP_MEM_SIZE_BYTES  (32u << 2u) // allocate 32 bytes
-static uint8_t temp_mem[MAX_TEMP_MEM_SIZE_BYTES];
+// elements are swapped in place, a small chunk at a time, through a buffer
+// living on the caller's stack. No state is shared between calls, so the
+// heap functions are reentrant and can be used on different heaps from
+// different contexts (task, ISR) at the same time. There is also no limit
+// on the element size.
+#define SWAP_CHUNK_SIZE_BYTES (16u)
 
 static inline void swap(void *e1, void *e2, size_t size)
 {
-    memcpy(temp_mem, e1, size);
-    memcpy(e1, e2, size);
-    memcpy(e2, temp_mem, size);
+    if (e1 == e2)
+    {
+        return;
+    }
+
+    uint8_t chunk[SWAP_CHUNK_SIZE_BYTES];
+    uint8_t *p1 = (uint8_t*) e1;
+    uint8_t *p2 = (uint8_t*) e2;
+    while (size > 0)
+    {
+        size_t n = (size < SWAP_CHUNK_SIZE_BYTES) ? size : SWAP_CHUNK_SIZE_BYTES;
+        memcpy(chunk, p1, n);
+        memcpy(p1, p2, n);
+        memcpy(p2, chunk, n);
+        p1 += n;
+        p2 += n;
+        size -= n;
+    }
 }
 
 static inline size_t get_parent_index(size_t child_index)
 {
-    return (child_index - 1) / 2;
+    return (child_index - 1) / CUSTOM_PQUEUE_ARITY;
 }
 
-static inline size_t get_child_one_index(size_t parent_index)
+static inline size_t get_first_child_index(size_t parent_index)
 {
-    return parent_index * 2 + 1;
+    return parent_index * CUSTOM_PQUEUE_ARITY + 1;
 }
 
-static inline size_t get_child_two_index(size_t parent_index)
+static inline void *get_element_address(void *array, size_t elem_size, size_t index)
 {
-    return parent_index * 2 + 2;
+    return (void*) ((uint8_t*) array + elem_size * index);
 }
 
-static inline void *get_element_address(void *array, size_t elem_size, size_t index)
+// addressable heap support
+// when a locator is given, every element carries its handle (at loc->hoffset)
+// and loc->pos[handle] is kept equal to the element index through every move
+static inline PQueue_Handle_t get_handle(const PQueueLocator_t *loc, void *elem)
 {
-    return (void*) ((uint8_t*) array + elem_size * index);
+    return *(PQueue_Handle_t*) ((uint8_t*) elem + loc->hoffset);
+}
+
+static inline void set_position(const PQueueLocator_t *loc, void *elem, size_t index)
+{
+    if (loc != NULL)
+    {
+        loc->pos[get_handle(loc, elem)] = (uint16_t) index;
+    }
+}
+
+static inline void clear_position(const PQueueLocator_t *loc, void *elem)
+{
+    if (loc != NULL)
+    {
+        loc->pos[get_handle(loc, elem)] = CUSTOM_PQUEUE_HANDLE_NONE;
+    }
+}
+
+// swap element at index i1 and i2, keeping the locator (if any) in sync
+static inline void swap_index(void *array, size_t elem_size, size_t i1, size_t i2,
+                              const PQueueLocator_t *loc)
+{
+    void *e1 = get_element_address(array, elem_size, i1);
+    void *e2 = get_element_address(array, elem_size, i2);
+    swap(e1, e2, elem_size);
+    set_position(loc, e1, i1);
+    set_position(loc, e2, i2);
 }
 
 // will try to sift up the designated element (index elem_index)
-static void sift_up(void *array,
-                    size_t elem_size, size_t elem_index,
-                    Compare_function_t cmp)
+// return the final index of the element
+static size_t sift_up(void *array,
+                      size_t elem_size, size_t elem_index,
+                      Compare_function_t cmp, const PQueueLocator_t *loc)
 {
     size_t parent_index = get_parent_index(elem_index);
     while (elem_index != 0)
@@ -56,7 +102,7 @@ static void sift_up(void *array,
 
         if (cmp(parent_address, current_address))
         {
-            swap(parent_address, current_address, elem_size);
+            swap_index(array, elem_size, parent_index, elem_index, loc);
             elem_index = parent_index;
             parent_index = get_parent_index(elem_index);
         }
@@ -65,56 +111,50 @@ static void sift_up(void *array,
             break;
         }
     }
+
+    return elem_index;
 }
 
 // will try to sift down the designated element (at index elem_index)
 static void sift_down(void *array, size_t arr_max_size,
                       size_t elem_size, size_t elem_index,
-                      Compare_function_t cmp)
+                      Compare_function_t cmp, const PQueueLocator_t *loc)
 {
     while (elem_index < arr_max_size)
     {
-        // if child_one (left) index is larger the array element count
-        // we have reached the end of the array, so top
-        size_t child_one_index = get_child_one_index(elem_index);
-        if (child_one_index >= arr_max_size)
+        // if the first child index is larger the array element count
+        // we have reached the end of the array, so stop
+        size_t first_child_index = get_first_child_index(elem_index);
+        if (first_child_index >= arr_max_size)
         {
             break;
         }
-        void *child_one_address = get_element_address(array, elem_size, child_one_index);
-
-        void *current_address = get_element_address(array, elem_size, elem_index);
 
-        // if child two (right) index is larger the array element count
-        // we have reached the end of the array (but child one is still valid)
-        size_t child_two_index = get_child_two_index(elem_index);
-        if (child_two_index >= arr_max_size)
+        // the last node may have less than CUSTOM_PQUEUE_ARITY children
+        size_t end_child_index = first_child_index + CUSTOM_PQUEUE_ARITY;
+        if (end_child_index > arr_max_size)
         {
-            if (cmp(current_address, child_one_address))
-            {
-                swap(current_address, child_one_address, elem_size);
-            }
-            break;
+            end_child_index = arr_max_size;
         }
-        void *child_two_address = get_element_address(array, elem_size, child_two_index);
 
-        // else we choose the max child and consider swapping it with the current element
-        void *max_child;
-        size_t max_index;
-        if (cmp(child_one_address, child_two_address))
+        // choose the max child and consider swapping it with the current element
+        size_t max_index = first_child_index;
+        void *max_child = get_element_address(array, elem_size, max_index);
+        for (size_t child_index = first_child_index + 1; child_index < end_child_index;
+                child_index++)
         {
-            max_child = child_two_address;
-            max_index = child_two_index;
-        }
-        else
-        {
-            max_child = child_one_address;
-            max_index = child_one_index;
+            void *child_address = get_element_address(array, elem_size, child_index);
+            if (cmp(max_child, child_address))
+            {
+                max_child = child_address;
+                max_index = child_index;
+            }
         }
 
+        void *current_address = get_element_address(array, elem_size, elem_index);
         if (cmp(current_address, max_child))
         {
-            swap(current_address, max_child, elem_size);
+            swap_index(array, elem_size, elem_index, max_index, loc);
             elem_index = max_index;
         }
         else
@@ -124,8 +164,8 @@ static void sift_down(void *array, size_t arr_max_size,
     }
 }
 
-void Custom_PQueue_Create(void *arr, size_t asize, size_t esize, size_t elemc,
-        Compare_function_t cmp)
+static void heap_create(void *arr, size_t asize, size_t esize, size_t elemc,
+        Compare_function_t cmp, const PQueueLocator_t *loc)
 {
     if (elemc > asize)
     {
@@ -133,7 +173,13 @@ void Custom_PQueue_Create(void *arr, size_t asize, size_t esize, size_t elemc,
         return;
     }
 
-    // we use the Floyd method for building a binary heap
+    // record the starting position of every element
+    for (size_t i = 0; i < elemc; i++)
+    {
+        set_position(loc, get_element_address(arr, esize, i), i);
+    }
+
+    // we use the Floyd method for building a heap
     // starting from the next to bottom layer, slowly go up,
     // and sift down every element
     // https://en.wikipedia.org/wiki/Binary_heap#Building_a_heap
@@ -146,17 +192,17 @@ void Custom_PQueue_Create(void *arr, size_t asize, size_t esize, size_t elemc,
     size_t current_index = get_parent_index(elemc - 1);
     while (1)
     {
-        if (current_index == -1u)
+        if (current_index == (size_t) -1)
             break;
 
-        sift_down(arr, elemc, esize, current_index, cmp);
+        sift_down(arr, elemc, esize, current_index, cmp, loc);
 
         current_index--;
     }
 }
 
-void Custom_PQueue_Insert(void *arr, size_t asize, size_t esize, size_t elemc, void *elem,
-        Compare_function_t cmp)
+static void heap_insert(void *arr, size_t asize, size_t esize, size_t elemc, void *elem,
+        Compare_function_t cmp, const PQueueLocator_t *loc)
 {
     if (elemc > asize)
     {
@@ -170,14 +216,15 @@ void Custom_PQueue_Insert(void *arr, size_t asize, size_t esize, size_t elemc, v
     }
 
     // copy the element to the next index within the array (elemc)
-    memcpy(get_element_address(arr, esize, elemc), elem, esize);
+    void *last_address = get_element_address(arr, esize, elemc);
+    memcpy(last_address, elem, esize);
+    set_position(loc, last_address, elemc);
     // sift up the added element
-    sift_up(arr, esize, elemc, cmp);
-
+    sift_up(arr, esize, elemc, cmp, loc);
 }
 
-void Custom_PQueue_Pop(void *arr, size_t asize, size_t esize, size_t elemc,
-        Compare_function_t cmp)
+static void heap_delete(void *arr, size_t esize, size_t elemc, size_t index,
+        Compare_function_t cmp, const PQueueLocator_t *loc)
 {
     if (elemc == 0)
     {
@@ -185,35 +232,262 @@ void Custom_PQueue_Pop(void *arr, size_t asize, size_t esize, size_t elemc,
         return;
     }
 
-    // swap the last element (index elemc - 1) with the first (index 0)
-    swap(get_element_address(arr, esize, 0),
-            get_element_address(arr, esize, elemc - 1), esize);
-    //sift down the first
-    sift_down(arr, elemc - 1, esize, 0, cmp);
+    // swap the last element (index elemc - 1) with the specified element (index)
+    swap_index(arr, esize, index, elemc - 1, loc);
+    clear_position(loc, get_element_address(arr, esize, elemc - 1));
+
+    // nothing left to fix if the deleted element was the last one
+    if (index == elemc - 1)
+    {
+        return;
+    }
+
+    // test sift up the element
+    index = sift_up(arr, esize, index, cmp, loc);
+    // test sift down the element
+    sift_down(arr, elemc - 1, esize, index, cmp, loc);
 }
 
-void Custom_PQueue_Delete(void *arr, size_t asize, size_t esize, size_t elemc, size_t index,
-        Compare_function_t cmp)
+// number of level of a heap containing elemc element
+static size_t heap_height(size_t elemc)
 {
-    if (elemc == 0)
+    size_t height = 0;
+    while (elemc > 0)
     {
-        Custom_Err_SetStatus(ERR_PQUEUE_EMPTYPOP);
+        height++;
+        elemc = (elemc - 1) / CUSTOM_PQUEUE_ARITY;
+    }
+    return height;
+}
+
+static void heap_insert_many(void *arr, size_t asize, size_t esize, size_t elemc,
+        const void *elems, size_t k, Compare_function_t cmp, const PQueueLocator_t *loc)
+{
+    if (elemc > asize)
+    {
+        Custom_Err_SetStatus(ERR_PQUEUE_INVALIDCOUNT);
+        return;
+    }
+    else if (k > asize - elemc)
+    {
+        Custom_Err_SetStatus(ERR_PQUEUE_FULLINSERT);
         return;
     }
 
-    // swap the last element (index elemc - 1) with the specified element (index)
-    swap(get_element_address(arr, esize, index),
-            get_element_address(arr, esize, elemc - 1), esize);
+    // k separate sift up cost about k * height, while rebuilding the whole heap
+    // (Floyd method) cost about (elemc + k), choose whichever is cheaper
+    size_t new_count = elemc + k;
+    if (k * heap_height(new_count) > new_count)
+    {
+        memcpy(get_element_address(arr, esize, elemc), elems, k * esize);
+        heap_create(arr, asize, esize, new_count, cmp, loc);
+    }
+    else
+    {
+        for (size_t i = 0; i < k; i++)
+        {
+            heap_insert(arr, asize, esize, elemc + i,
+                    get_element_address((void*) elems, esize, i), cmp, loc);
+        }
+    }
+}
 
-    // test sift up the element
-    sift_up(arr, esize, index, cmp);
-    // test sift down the element
-    sift_down(arr, elemc - 1, esize, index, cmp);
+// remove every element ranking strictly higher than key, copy them into out
+// return the number of element removed
+static size_t heap_pop_above(void *arr, size_t asize, size_t esize, size_t elemc,
+        void *key, void *out, Compare_function_t cmp, const PQueueLocator_t *loc)
+{
+    size_t count = 0;
+
+    // while there are few of them, pop one by one from the top (k * height),
+    // it is stopped when removing the rest by rebuilding the heap (about elemc)
+    // would be cheaper
+    size_t pop_limit = elemc / heap_height(elemc + 1);
+    while (elemc > 0 && cmp(key, arr))
+    {
+        if (count == pop_limit)
+        {
+            break;
+        }
+        memcpy(get_element_address(out, esize, count), arr, esize);
+        heap_delete(arr, esize, elemc, 0, cmp, loc);
+        elemc--;
+        count++;
+    }
+
+    if (elemc == 0 || !cmp(key, arr))
+    {
+        return count;
+    }
+
+    // scan through the heap in one pass, move out every element that rank higher
+    // than key and pack the rest to the front, then rebuild the heap
+    size_t keep_count = 0;
+    for (size_t i = 0; i < elemc; i++)
+    {
+        void *current_address = get_element_address(arr, esize, i);
+        if (cmp(key, current_address))
+        {
+            memcpy(get_element_address(out, esize, count), current_address, esize);
+            clear_position(loc, current_address);
+            count++;
+        }
+        else
+        {
+            void *keep_address = get_element_address(arr, esize, keep_count);
+            if (keep_address != current_address)
+            {
+                memcpy(keep_address, current_address, esize);
+            }
+            keep_count++;
+        }
+    }
+    heap_create(arr, asize, esize, keep_count, cmp, loc);
+
+    return count;
+}
+
+void Custom_PQueue_Create(void *arr, size_t asize, size_t esize, size_t elemc,
+        Compare_function_t cmp)
+{
+    heap_create(arr, asize, esize, elemc, cmp, NULL);
+}
+
+void Custom_PQueue_Insert(void *arr, size_t asize, size_t esize, size_t elemc, void *elem,
+        Compare_function_t cmp)
+{
+    heap_insert(arr, asize, esize, elemc, elem, cmp, NULL);
+}
+
+void Custom_PQueue_Pop(void *arr, size_t asize, size_t esize, size_t elemc,
+        Compare_function_t cmp)
+{
+    heap_delete(arr, esize, elemc, 0, cmp, NULL);
+}
+
+void Custom_PQueue_Delete(void *arr, size_t asize, size_t esize, size_t elemc, size_t index,
+        Compare_function_t cmp)
+{
+    heap_delete(arr, esize, elemc, index, cmp, NULL);
 }
 
 void Custom_PQueue_PushDown(void *arr, size_t esize, size_t elemc,
         Compare_function_t cmp)
 {
-    sift_down(arr, elemc, esize, 0, cmp);
+    sift_down(arr, elemc, esize, 0, cmp, NULL);
+}
+
+void Custom_PQueue_InsertMany(void *arr, size_t asize, size_t esize, size_t elemc,
+        const void *elems, size_t k, Compare_function_t cmp)
+{
+    heap_insert_many(arr, asize, esize, elemc, elems, k, cmp, NULL);
+}
+
+size_t Custom_PQueue_PopAbove(void *arr, size_t asize, size_t esize, size_t elemc,
+        void *key, void *out, Compare_function_t cmp)
+{
+    return heap_pop_above(arr, asize, esize, elemc, key, out, cmp, NULL);
+}
+
+void Custom_PQueue_LocCreate(void *arr, size_t asize, size_t esize, size_t elemc,
+        const PQueueLocator_t *loc, Compare_function_t cmp)
+{
+    heap_create(arr, asize, esize, elemc, cmp, loc);
+}
+
+PQueue_Handle_t Custom_PQueue_LocInsert(void *arr, size_t asize, size_t esize, size_t elemc,
+        void *elem, const PQueueLocator_t *loc, Compare_function_t cmp)
+{
+    heap_insert(arr, asize, esize, elemc, elem, cmp, loc);
+    if (elemc >= asize)
+    {
+        return CUSTOM_PQUEUE_HANDLE_NONE; // not inserted, error already reported
+    }
+
+    return get_handle(loc, elem);
+}
+
+void Custom_PQueue_LocPop(void *arr, size_t asize, size_t esize, size_t elemc,
+        const PQueueLocator_t *loc, Compare_function_t cmp)
+{
+    heap_delete(arr, esize, elemc, 0, cmp, loc);
+}
+
+void Custom_PQueue_LocRemove(void *arr, size_t asize, size_t esize, size_t elemc,
+        PQueue_Handle_t handle, const PQueueLocator_t *loc, Compare_function_t cmp)
+{
+    uint16_t index = loc->pos[handle];
+    if (index == CUSTOM_PQUEUE_HANDLE_NONE || index >= elemc)
+    {
+        Custom_Err_SetStatus(ERR_PQUEUE_INVALIDHANDLE);
+        return;
+    }
+
+    heap_delete(arr, esize, elemc, index, cmp, loc);
+}
+
+void *Custom_PQueue_LocGet(void *arr, size_t esize, size_t elemc,
+        PQueue_Handle_t handle, const PQueueLocator_t *loc)
+{
+    uint16_t index = loc->pos[handle];
+    if (index == CUSTOM_PQUEUE_HANDLE_NONE || index >= elemc)
+    {
+        return NULL;
+    }
+
+    return get_element_address(arr, esize, index);
+}
+
+void Custom_PQueue_LocUpdate(void *arr, size_t esize, size_t elemc,
+        PQueue_Handle_t handle, const PQueueLocator_t *loc, Compare_function_t cmp)
+{
+    uint16_t index = loc->pos[handle];
+    if (index == CUSTOM_PQUEUE_HANDLE_NONE || index >= elemc)
+    {
+        Custom_Err_SetStatus(ERR_PQUEUE_INVALIDHANDLE);
+        return;
+    }
+
+    // the key may have moved either way, at most one of the two sift will move it
+    size_t new_index = sift_up(arr, esize, index, cmp, loc);
+    sift_down(arr, elemc, esize, new_index, cmp, loc);
+}
+
+void Custom_PQueue_LocIncreaseKey(void *arr, size_t esize, size_t elemc,
+        PQueue_Handle_t handle, const PQueueLocator_t *loc, Compare_function_t cmp)
+{
+    uint16_t index = loc->pos[handle];
+    if (index == CUSTOM_PQUEUE_HANDLE_NONE || index >= elemc)
+    {
+        Custom_Err_SetStatus(ERR_PQUEUE_INVALIDHANDLE);
+        return;
+    }
+
+    sift_up(arr, esize, index, cmp, loc);
+}
+
+void Custom_PQueue_LocDecreaseKey(void *arr, size_t esize, size_t elemc,
+        PQueue_Handle_t handle, const PQueueLocator_t *loc, Compare_function_t cmp)
+{
+    uint16_t index = loc->pos[handle];
+    if (index == CUSTOM_PQUEUE_HANDLE_NONE || index >= elemc)
+    {
+        Custom_Err_SetStatus(ERR_PQUEUE_INVALIDHANDLE);
+        return;
+    }
+
+    sift_down(arr, elemc, esize, index, cmp, loc);
+}
+
+void Custom_PQueue_LocInsertMany(void *arr, size_t asize, size_t esize, size_t elemc,
+        const void *elems, size_t k, const PQueueLocator_t *loc, Compare_function_t cmp)
+{
+    heap_insert_many(arr, asize, esize, elemc, elems, k, cmp, loc);
+}
+
+size_t Custom_PQueue_LocPopAbove(void *arr, size_t asize, size_t esize, size_t elemc,
+        void *key, void *out, const PQueueLocator_t *loc, Compare_function_t cmp)
+{
+    return heap_pop_above(arr, asize, esize, elemc, key, out, cmp, loc);
 }
 
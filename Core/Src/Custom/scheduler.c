@@ -6,8 +6,13 @@
  */
 
 #include "Custom/scheduler.h"
+#include "Custom/circular_buffer.h"
+#include "Custom/cpu_load.h"
+#include "Custom/critical_section.h"
 #include "Custom/priority_queue.h"
 #include "Custom/scheduler_task.h"
+#include "Custom/timestamp.h"
+#include "Custom/trace.h"
 
 #ifdef CUSTOM_SCHEDULER_USE_WATCHDOG
 #include "iwdg.h"
@@ -15,6 +20,7 @@
 #endif
 
 #include "stdint.h"
+#include "string.h"
 #include "stm32f1xx_hal_pwr.h"
 #include "stm32f1xx_hal_tim.h"
 #include "tim.h"
@@ -36,26 +42,529 @@ static inline void fix_all_timestamp_overflow();
 
 // global tick counter
 static uint32_t volatile system_tick_count = 0;
-// static array contaning the priorirty queue
-static SchedTask_t bin_heap[CUSTOM_SCHEDULER_BIHEAP_SIZE];
-// counter for the number of task within heap
+// counter for the number of task within the scheduler (waiting, ready or running)
 static size_t task_count = 0;
+
+// slot array containing the cold part of every task, indexed by task handle
+static SchedTask_t task_slot[CUSTOM_SCHEDULER_BIHEAP_SIZE];
+// timing statistic of every task, indexed by task handle
+static SchedTaskStat_t task_stat[CUSTOM_SCHEDULER_BIHEAP_SIZE];
+// number of tick the running task have been running, counted by the tick ISR
+static uint32_t volatile running_tick = 0;
+// if the running task exceeded its budget
+static uint8_t volatile running_over_budget = 0;
+// last task that exceeded its budget, kept across reset
+static SchedBudgetRecord_t budget_record __attribute__((section(".noinit")));
+
+// task chaining, indexed by handle: next stage of the task (the task run when it return
+// with an output), previous stage (so unlinking is O(1)), and input handed to the task
+// and not taken yet
+static SchedTask_Handle_t chain_next[CUSTOM_SCHEDULER_BIHEAP_SIZE];
+static SchedTask_Handle_t chain_prev[CUSTOM_SCHEDULER_BIHEAP_SIZE];
+static void *chain_input[CUSTOM_SCHEDULER_BIHEAP_SIZE];
+// output given by the running task, if running_has_output
+static void *running_output;
+static uint8_t running_has_output = 0;
+
+// load per tick over the phase horizon, and the result of the last spread
+static uint32_t phase_load[CUSTOM_SCHEDULER_PHASE_HORIZON];
+static SchedPhaseReport_t phase_report;
+static uint8_t phase_report_valid = 0;
+
+// static array contaning the priorirty queue of waiting task (key only)
+// ordered by runAtTick, the task that is due first is on top
+static SchedKey_t bin_heap[CUSTOM_SCHEDULER_BIHEAP_SIZE];
+// counter for the number of task within bin_heap
+static size_t wait_count = 0;
+// locator for the heap, task_pos[handle] is the index of the task within bin_heap
+static uint16_t task_pos[CUSTOM_SCHEDULER_BIHEAP_SIZE];
+static const PQueueLocator_t task_loc =
+{
+    .pos = task_pos,
+    .hoffset = offsetof(SchedKey_t, slot),
+};
+
+// static array containing the priority queue of task that are due and waiting to
+// be run in the current dispatch pass, ordered by Custom_SchedTask_Compare_Smaller
+static SchedKey_t ready_heap[CUSTOM_SCHEDULER_BIHEAP_SIZE];
+// counter for the number of task within ready_heap
+static size_t ready_count = 0;
+// locator for the ready heap, ready_pos[handle] is the index of the task within ready_heap
+static uint16_t ready_pos[CUSTOM_SCHEDULER_BIHEAP_SIZE];
+static const PQueueLocator_t ready_loc =
+{
+    .pos = ready_pos,
+    .hoffset = offsetof(SchedKey_t, slot),
+};
+
+// key of the task currently running, it is neither in bin_heap nor in ready_heap
+static SchedKey_t running_key;
+// if the running task was deleted or rescheduled while it is running
+static uint8_t running_is_deleted = 0;
+static uint8_t running_is_rescheduled = 0;
+
+// handle of task that have been signaled, waiting to be made ready
+// each task is within the queue at most once (guarded by isSignaled)
+static SchedTask_Handle_t signal_queue[CUSTOM_SCHEDULER_BIHEAP_SIZE];
+static size_t signal_head = 0;
+static size_t volatile signal_count = 0;
+
+// handle allocation, freed handle are kept in a stack, handle that
+// have never been used start from handle_unused
+static SchedTask_Handle_t handle_free[CUSTOM_SCHEDULER_BIHEAP_SIZE];
+static size_t handle_free_count = 0;
+static SchedTask_Handle_t handle_unused = 0;
 // if the scheduler is running or not
 static uint8_t scheduler_is_running = 0;
 // if a task is currently running
-static uint8_t task_is_running = 0;
+static uint8_t volatile task_is_running = 0;
 
 // if we need to defer interrupt for updating system_tick_count
 static uint8_t defer_tick_update = 0;
 // if number of tick deferred
-static uint32_t defer_tick_update_count = 0;
+static uint32_t volatile defer_tick_update_count = 0;
+
+#ifdef CUSTOM_SCHEDULER_USE_URGENT_BAND
+// task of the urgent band, urgent_task[i] have the handle CUSTOM_SCHEDULER_BIHEAP_SIZE + i
+static SchedUrgentTask_t urgent_task[CUSTOM_SCHEDULER_URGENT_SIZE];
+static SchedUrgentStat_t urgent_stat[CUSTOM_SCHEDULER_URGENT_SIZE];
+#endif
+
+#ifdef CUSTOM_SCHEDULER_POLICY_EDF
+// density admitted by Custom_Scheduler_AddEdf (indexed by handle), and their sum, in ppm
+// the execution time is kept to admit the task again when its deadline or period change
+#define EDF_DENSITY_FULL 1000000u
+static uint32_t edf_density[CUSTOM_SCHEDULER_BIHEAP_SIZE];
+static uint32_t edf_wcet_us[CUSTOM_SCHEDULER_BIHEAP_SIZE];
+static uint32_t edf_density_total = 0;
+#endif
+
+#ifdef CUSTOM_SCHEDULER_USE_CYCLIC
+// tick elapsed in the current minor frame, and number of minor frame due (tick ISR)
+static uint32_t cyclic_tick = 0;
+static uint32_t volatile cyclic_due = 0;
+// next minor frame of the table to run
+static uint16_t cyclic_frame_index = 0;
+static SchedCyclicStat_t cyclic_stat;
+#endif
+
+static SchedTask_Handle_t allocate_handle(void)
+{
+    if (handle_free_count > 0)
+    {
+        handle_free_count--;
+        return handle_free[handle_free_count];
+    }
+    if (handle_unused < CUSTOM_SCHEDULER_BIHEAP_SIZE)
+    {
+        task_pos[handle_unused] = CUSTOM_PQUEUE_HANDLE_NONE;
+        ready_pos[handle_unused] = CUSTOM_PQUEUE_HANDLE_NONE;
+        chain_next[handle_unused] = CUSTOM_SCHEDULER_HANDLE_NONE;
+        chain_prev[handle_unused] = CUSTOM_SCHEDULER_HANDLE_NONE;
+        chain_input[handle_unused] = NULL;
+        return handle_unused++;
+    }
+    return CUSTOM_SCHEDULER_HANDLE_NONE;
+}
+
+// remove the link from the task to its next stage
+static void chain_unlink(SchedTask_Handle_t handle)
+{
+    SchedTask_Handle_t next = chain_next[handle];
+    if (next != CUSTOM_SCHEDULER_HANDLE_NONE)
+    {
+        chain_prev[next] = CUSTOM_SCHEDULER_HANDLE_NONE;
+        chain_next[handle] = CUSTOM_SCHEDULER_HANDLE_NONE;
+    }
+}
+
+static void release_handle(SchedTask_Handle_t handle)
+{
+    uint32_t primask = Custom_Critical_Enter();
+    task_slot[handle].pTask = NULL;
+    task_slot[handle].isSignaled = 0;
+    Custom_Critical_Exit(primask);
+    task_pos[handle] = CUSTOM_PQUEUE_HANDLE_NONE;
+    ready_pos[handle] = CUSTOM_PQUEUE_HANDLE_NONE;
+    // unlink the task from its chain, so the handle can be given again
+    chain_unlink(handle);
+    if (chain_prev[handle] != CUSTOM_SCHEDULER_HANDLE_NONE)
+    {
+        chain_next[chain_prev[handle]] = CUSTOM_SCHEDULER_HANDLE_NONE;
+        chain_prev[handle] = CUSTOM_SCHEDULER_HANDLE_NONE;
+    }
+    chain_input[handle] = NULL;
+#ifdef CUSTOM_SCHEDULER_POLICY_EDF
+    edf_density_total -= edf_density[handle];
+    edf_density[handle] = 0;
+    edf_wcet_us[handle] = 0;
+#endif
+    handle_free[handle_free_count] = handle;
+    handle_free_count++;
+    task_count--;
+}
+
+static inline void count_saturate(uint16_t *counter, uint32_t amount)
+{
+    *counter = (*counter + amount > UINT16_MAX) ? UINT16_MAX : (uint16_t) (*counter + amount);
+}
+
+static void clear_stat(SchedTask_Handle_t handle)
+{
+    SchedTaskStat_t *stat = &task_stat[handle];
+    for (size_t i = 0; i < CUSTOM_SCHEDULER_LATENESS_BUCKET; i++)
+    {
+        stat->lateness[i] = 0;
+    }
+    stat->overrun = 0;
+    stat->skipped = 0;
+    stat->max_run_us = 0;
+}
+
+// count a run by how late it started, bucket i hold lateness in [2^(i-1), 2^i)
+static void record_lateness(SchedTask_Handle_t handle, uint32_t lateness)
+{
+    uint8_t bucket = 0;
+    while (lateness > 0 && bucket < CUSTOM_SCHEDULER_LATENESS_BUCKET - 1)
+    {
+        lateness >>= 1;
+        bucket++;
+    }
+    count_saturate(&task_stat[handle].lateness[bucket], 1);
+}
+
+static void record_run_time(SchedTask_Handle_t handle, uint32_t run_us)
+{
+    SchedTaskStat_t *stat = &task_stat[handle];
+    if (run_us > stat->max_run_us)
+    {
+        stat->max_run_us = (run_us > UINT16_MAX) ? UINT16_MAX : (uint16_t) run_us;
+    }
+}
+
+// current tick, including the tick deferred during the dispatch pass
+static inline uint32_t current_tick(void)
+{
+    return system_tick_count + defer_tick_update_count;
+}
+
+// next run of a periodic task which just ran, according to its overrun policy
+static void reload_periodic(SchedKey_t *key, uint32_t period)
+{
+    SchedTaskStat_t *stat = &task_stat[key->slot];
+    increment_timestamp(&key->runAtTick, period);
+
+    uint32_t now = current_tick();
+    if (key->runAtTick >= now)
+    {
+        return; // the next period have not begun yet
+    }
+
+    // number of period begun while the task was late
+    uint32_t missed = (now - key->runAtTick + period - 1) / period;
+    count_saturate(&stat->overrun, 1);
+    switch (stat->policy)
+    {
+    case SCHED_OVERRUN_SKIP:
+        count_saturate(&stat->skipped, missed);
+        increment_timestamp(&key->runAtTick, missed * period);
+        break;
+    case SCHED_OVERRUN_COALESCE:
+        count_saturate(&stat->skipped, missed - 1);
+        key->runAtTick = now;
+        break;
+    default:
+        break; // catch up, the key is already due
+    }
+}
+
+// called from the tick ISR while a task is running
+static void check_budget(void)
+{
+    running_tick++;
+    const SchedTaskStat_t *stat = &task_stat[running_key.slot];
+    if (stat->budget_tick == 0 || running_over_budget || running_tick <= stat->budget_tick)
+    {
+        return;
+    }
+
+    running_over_budget = 1;
+    if (budget_record.magic != CUSTOM_SCHEDULER_BUDGET_MAGIC)
+    {
+        budget_record.magic = CUSTOM_SCHEDULER_BUDGET_MAGIC;
+        budget_record.count = 0;
+    }
+    budget_record.count++;
+    budget_record.tick = current_tick();
+    budget_record.handle = running_key.slot;
+    budget_record.taskID = task_slot[running_key.slot].taskID;
+    budget_record.action = stat->budget_action;
+
+    if (stat->budget_action == SCHED_BUDGET_RESET)
+    {
+        NVIC_SystemReset();
+    }
+}
+
+#ifdef CUSTOM_SCHEDULER_USE_URGENT_BAND
+// release an urgent task, PendSV run it once no ISR is running
+// called with interrupt masked, or from ISR
+static void release_urgent(size_t index)
+{
+    SchedUrgentTask_t *task = &urgent_task[index];
+    if (task->isReleased)
+    {
+        count_saturate(&urgent_stat[index].overrun, 1);
+        return;
+    }
+    task->isReleased = 1;
+    task->releaseUs = Custom_Timestamp_GetUs();
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+// called from the tick ISR, release the periodic urgent task that are due
+static void update_urgent(void)
+{
+    for (size_t i = 0; i < CUSTOM_SCHEDULER_URGENT_SIZE; i++)
+    {
+        SchedUrgentTask_t *task = &urgent_task[i];
+        if (task->pTask != NULL && task->periodTick > 0 && --task->countdownTick == 0)
+        {
+            task->countdownTick = task->periodTick;
+            release_urgent(i);
+        }
+    }
+}
+#endif
+
+#ifdef CUSTOM_SCHEDULER_USE_CYCLIC
+// run the minor frame that is due, straight from the table
+// a frame due while the previous one was running is skipped, so the frame stay aligned
+static void run_cyclic(void)
+{
+    uint32_t primask = Custom_Critical_Enter();
+    uint32_t due = cyclic_due;
+    cyclic_due = 0;
+    Custom_Critical_Exit(primask);
+    if (due == 0)
+    {
+        return;
+    }
+    if (due > 1)
+    {
+        count_saturate(&cyclic_stat.skipped, due - 1);
+    }
+
+    const SchedCyclicTable_t *table = &sched_cyclic_table;
+    const SchedCyclicFrame_t *frame =
+            &table->frame[(cyclic_frame_index + due - 1) % table->frameCount];
+    cyclic_frame_index = (cyclic_frame_index + due) % table->frameCount;
+
+    uint32_t start = Custom_Timestamp_GetUs();
+    for (uint16_t i = frame->first; i < frame->first + frame->count; i++)
+    {
+        const SchedCyclicEntry_t *entry = &table->entry[i];
+#ifdef CUSTOM_SCHEDULER_USE_WATCHDOG
+        HAL_IWDG_Refresh(&hiwdg);
+#endif
+        CUSTOM_TRACE(TRACE_EVENT_TASK_START, CUSTOM_SCHEDULER_HANDLE_NONE, entry->taskID);
+        CUSTOM_CPULOAD_TASK_BEGIN();
+        entry->pTask(entry->pTaskArg);
+        CUSTOM_CPULOAD_TASK_END();
+        CUSTOM_TRACE(TRACE_EVENT_TASK_END, CUSTOM_SCHEDULER_HANDLE_NONE, entry->taskID);
+    }
+    uint32_t elapsed = Custom_Timestamp_GetUs() - start;
+    if (elapsed > cyclic_stat.maxFrameUs)
+    {
+        cyclic_stat.maxFrameUs = elapsed;
+    }
+    cyclic_stat.frame++;
+}
+#endif
+
+// ordering of the waiting task, a task rank lower if it is due later
+static uint8_t compare_run_later(void *task1, void *task2)
+{
+    return ((SchedKey_t*) task1)->runAtTick > ((SchedKey_t*) task2)->runAtTick;
+}
+
+// if the handle is a task (added and not deleted)
+static inline uint8_t task_exists(SchedTask_Handle_t handle)
+{
+    return (handle < handle_unused && task_slot[handle].pTask != NULL);
+}
+
+// where a task can be found
+typedef enum
+{
+    TASK_NOT_FOUND,
+    TASK_WAITING,
+    TASK_READY,
+    TASK_RUNNING,
+    TASK_IDLE, // event task waiting for a signal
+} TaskLocation_t;
+
+// get the key of the task with the provided handle (and where it is),
+// NULL if there is no such task (or it is an idle event task, which have no key)
+static SchedKey_t *get_key(SchedTask_Handle_t handle, TaskLocation_t *where)
+{
+    SchedKey_t *key = NULL;
+    *where = TASK_NOT_FOUND;
+    if (handle >= handle_unused || task_slot[handle].pTask == NULL)
+    {
+        return NULL;
+    }
+
+    if ((key = Custom_PQueue_LocGet(bin_heap, sizeof(SchedKey_t), wait_count,
+            handle, &task_loc)) != NULL)
+    {
+        *where = TASK_WAITING;
+    }
+    else if ((key = Custom_PQueue_LocGet(ready_heap, sizeof(SchedKey_t), ready_count,
+            handle, &ready_loc)) != NULL)
+    {
+        *where = TASK_READY;
+    }
+    else if (task_is_running && running_key.slot == handle)
+    {
+        if (!running_is_deleted)
+        {
+            key = &running_key;
+            *where = TASK_RUNNING;
+        }
+    }
+    else if (task_slot[handle].isEvent)
+    {
+        *where = TASK_IDLE;
+    }
+    return key;
+}
+
+// key of the task with the provided handle, to be run at the provided tick
+static inline SchedKey_t make_key(SchedTask_Handle_t handle, uint32_t runAtTick)
+{
+    SchedKey_t key =
+    {
+        .runAtTick = runAtTick,
+        .slot = handle,
+        .priority = task_slot[handle].priority,
+#ifdef CUSTOM_SCHEDULER_POLICY_EDF
+        .deadlineTick = task_slot[handle].deadlineTick,
+#endif
+    };
+    return key;
+}
+
+// put a task into the waiting heap
+static void add_waiting(SchedKey_t *key)
+{
+    Custom_PQueue_LocInsert(bin_heap, CUSTOM_SCHEDULER_BIHEAP_SIZE, sizeof(SchedKey_t),
+            wait_count, key, &task_loc, compare_run_later);
+    wait_count++;
+}
+
+// put a task into the ready heap
+static void add_ready(SchedKey_t *key)
+{
+    Custom_PQueue_LocInsert(ready_heap, CUSTOM_SCHEDULER_BIHEAP_SIZE, sizeof(SchedKey_t),
+            ready_count, key, &ready_loc, Custom_SchedTask_Compare_Smaller);
+    ready_count++;
+}
+
+// make a task ready, to be run in the current dispatch pass
+static void make_ready(SchedTask_Handle_t handle)
+{
+    TaskLocation_t where;
+    SchedKey_t *key = get_key(handle, &where);
+    if (where == TASK_IDLE)
+    {
+        SchedKey_t new_key = make_key(handle, system_tick_count);
+        add_ready(&new_key);
+    }
+    else if (where == TASK_WAITING)
+    {
+        // run it now instead of waiting, the schedule is restarted from now
+        SchedKey_t moved_key = *key;
+        moved_key.runAtTick = system_tick_count;
+        Custom_PQueue_LocRemove(bin_heap, CUSTOM_SCHEDULER_BIHEAP_SIZE, sizeof(SchedKey_t),
+                wait_count, handle, &task_loc, compare_run_later);
+        wait_count--;
+        add_ready(&moved_key);
+    }
+    else
+    {
+        // already ready, nothing to do
+    }
+}
+
+// the running task returned with an output, hand it to the next stage of its chain
+static void hand_off_output(void)
+{
+    SchedTask_Handle_t next = chain_next[running_key.slot];
+    if (next == CUSTOM_SCHEDULER_HANDLE_NONE)
+    {
+        return;
+    }
+    // a stage that did not take its previous input yet only get the latest one
+    chain_input[next] = running_output;
+    make_ready(next);
+}
+
+// make every signaled task ready
+static void move_signaled_to_ready(void)
+{
+    while (signal_count > 0)
+    {
+        uint32_t primask = Custom_Critical_Enter();
+        SchedTask_Handle_t handle = signal_queue[signal_head];
+        Custom_CirBuff_Delete(CUSTOM_SCHEDULER_BIHEAP_SIZE, &signal_head, (size_t*) &signal_count);
+        uint8_t is_signaled = task_slot[handle].isSignaled;
+        task_slot[handle].isSignaled = 0;
+        Custom_Critical_Exit(primask);
+
+        if (!is_signaled)
+        {
+            continue; // task deleted after being signaled
+        }
+        make_ready(handle);
+    }
+}
+
+// put the uC into sleep state until the next interrupt
+// interrupt are masked while checking for signal, so that a signal arriving right
+// before sleeping still wake the core up (a pending interrupt end WFI even when masked)
+static void enter_sleep(void)
+{
+    uint32_t primask = Custom_Critical_Enter();
+#ifdef CUSTOM_SCHEDULER_USE_CYCLIC
+    if (signal_count == 0 && cyclic_due == 0)
+#else
+    if (signal_count == 0)
+#endif
+    {
+        CUSTOM_CPULOAD_SLEEP_BEGIN();
+        HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+        CUSTOM_CPULOAD_SLEEP_END();
+    }
+    Custom_Critical_Exit(primask);
+}
 
 // compare function for task
-// assume that e1 and e2 points to SchedTask_t
+// assume that e1 and e2 points to SchedKey_t
 __weak uint8_t Custom_SchedTask_Compare_Smaller(void *task1, void *task2)
 {
-    SchedTask_t *elem1 = (SchedTask_t*) task1;
-    SchedTask_t *elem2 = (SchedTask_t*) task2;
+    SchedKey_t *elem1 = (SchedKey_t*) task1;
+    SchedKey_t *elem2 = (SchedKey_t*) task2;
+
+#ifdef CUSTOM_SCHEDULER_POLICY_EDF
+    // compare by absolute deadline first, the earliest rank higher
+    uint64_t deadline1 = (uint64_t) elem1->runAtTick + elem1->deadlineTick;
+    uint64_t deadline2 = (uint64_t) elem2->runAtTick + elem2->deadlineTick;
+    if (deadline1 != deadline2)
+    {
+        return deadline1 > deadline2;
+    }
+#endif
 
     // compare by priority first
     if (elem1->priority < elem2->priority)
@@ -88,6 +597,19 @@ void Custom_Scheduler_Init(void)
     if (scheduler_is_running)
     {
         task_count = 0; // clear all old task
+        wait_count = 0;
+        handle_free_count = 0;
+        handle_unused = 0;
+#ifdef CUSTOM_SCHEDULER_POLICY_EDF
+        memset(edf_density, 0, sizeof(edf_density));
+        memset(edf_wcet_us, 0, sizeof(edf_wcet_us));
+        edf_density_total = 0;
+#endif
+#ifdef CUSTOM_SCHEDULER_USE_URGENT_BAND
+        uint32_t primask = Custom_Critical_Enter();
+        memset(urgent_task, 0, sizeof(urgent_task));
+        Custom_Critical_Exit(primask);
+#endif
     }
     else
     {
@@ -96,18 +618,31 @@ void Custom_Scheduler_Init(void)
     system_tick_count = 0;
     scheduler_is_running = 1;
     task_is_running = 0;
+    ready_count = 0;
 
     defer_tick_update = 0;
     defer_tick_update_count = 0;
+#ifdef CUSTOM_SCHEDULER_USE_CYCLIC
+    // the major frame start with the timer
+    cyclic_tick = 0;
+    cyclic_due = 0;
+    cyclic_frame_index = 0;
+    memset(&cyclic_stat, 0, sizeof(cyclic_stat));
+#endif
 
-    Custom_PQueue_Create(bin_heap, CUSTOM_SCHEDULER_BIHEAP_SIZE, sizeof(SchedTask_t),
-            task_count, Custom_SchedTask_Compare_Smaller);
+    Custom_PQueue_LocCreate(bin_heap, CUSTOM_SCHEDULER_BIHEAP_SIZE, sizeof(SchedKey_t),
+            wait_count, &task_loc, compare_run_later);
 
     // init timer and watchdog
 #ifdef CUSTOM_SCHEDULER_USE_WATCHDOG
     MX_IWDG_Init(); // defined by CubeMx in iwdg.c
 #endif
 
+#ifdef CUSTOM_SCHEDULER_USE_URGENT_BAND
+    // below every ISR, so urgent task only preempt the cooperative task
+    HAL_NVIC_SetPriority(PendSV_IRQn, CUSTOM_SCHEDULER_URGENT_NVIC_PRIORITY, 0);
+#endif
+
     MX_TIM3_Init(); // defined by CubeMx in tim.c
     HAL_TIM_Base_Start_IT(&htim3);
 }
@@ -130,154 +665,999 @@ void Custom_Scheduler_Update(void)
     {
         defer_tick_update_count++;
     }
+    if (task_is_running)
+    {
+        check_budget();
+    }
+#ifdef CUSTOM_SCHEDULER_USE_URGENT_BAND
+    update_urgent();
+#endif
+#ifdef CUSTOM_SCHEDULER_USE_CYCLIC
+    if (++cyclic_tick >= sched_cyclic_table.minorTick)
+    {
+        cyclic_tick = 0;
+        cyclic_due++;
+    }
+#endif
 }
 
-void Custom_Scheduler_Add(SchedTask_Func_t pTask, void *pArg,
-        uint8_t priority, uint32_t period, uint32_t delay, uint8_t ID)
+// add a timed task, the deadline is only used by the EDF policy
+static SchedTask_Handle_t add_task(SchedTask_Func_t pTask, void *pArg, uint8_t priority,
+        uint32_t period, uint32_t delay, uint32_t deadline, uint8_t ID)
 {
     if (task_count == CUSTOM_SCHEDULER_BIHEAP_SIZE)
     {
         Custom_Err_SetStatus(ERR_SCHEDULER_FULLADD);
-        return;
+        return CUSTOM_SCHEDULER_HANDLE_NONE;
     }
 
+    SchedTask_Handle_t handle = allocate_handle();
+    SchedTask_t *slot = &task_slot[handle];
+    slot->pTask = pTask;
+    slot->pTaskArg = pArg;
+    slot->periodTick = period;
+    slot->taskID = ID;
+    slot->priority = priority;
+    slot->isEvent = 0;
+    slot->isSignaled = 0;
+#ifdef CUSTOM_SCHEDULER_POLICY_EDF
+    slot->deadlineTick = deadline;
+#endif
+    task_count++;
+    clear_stat(handle);
+    task_stat[handle].policy = CUSTOM_SCHEDULER_DEFAULT_OVERRUN_POLICY;
+    task_stat[handle].budget_tick = 0;
+    task_stat[handle].cost_us = 0;
+
     if (scheduler_is_running)
     {
         // assume that the the binary heap is already created
-        SchedTask_t new_task =
-        {
-            .pTask = pTask,
-            .pTaskArg = pArg,
-            .priority = priority,
-            .periodTick = period,
-            .runAtTick = system_tick_count,
-            .taskID = ID,
-        };
-
-        Custom_PQueue_Insert(bin_heap, CUSTOM_SCHEDULER_BIHEAP_SIZE, sizeof(SchedTask_t), task_count,
-                &new_task, Custom_SchedTask_Compare_Smaller);
+        SchedKey_t new_key = make_key(handle, system_tick_count);
+        increment_timestamp(&new_key.runAtTick, delay);
 
-        increment_timestamp(&new_task.runAtTick, delay);
+        add_waiting(&new_key);
     }
     else
     {
         // assume that we are adding task before the heap is created
         // so task can be added sequentially
-        SchedTask_t *current = &bin_heap[task_count];
-        current->pTask = pTask;
-        current->pTaskArg = pArg;
-        current->priority = priority;
-        current->periodTick = period;
-        current->runAtTick = delay;
-        current->taskID = ID;
+        bin_heap[wait_count] = make_key(handle, delay);
+        wait_count++;
     }
-    task_count++;
+
+    CUSTOM_TRACE(TRACE_EVENT_TASK_ADD, handle, ID);
+    return handle;
 }
 
-void Custom_Scheduler_Delete(uint8_t ID)
+SchedTask_Handle_t Custom_Scheduler_Add(SchedTask_Func_t pTask, void *pArg,
+        uint8_t priority, uint32_t period, uint32_t delay, uint8_t ID)
 {
-    if (task_count == 0)
+    // implicit deadline: a periodic task have to finish before its next release
+    return add_task(pTask, pArg, priority, period, delay, period, ID);
+}
+
+#ifdef CUSTOM_SCHEDULER_POLICY_EDF
+// density (rounded up) of a task, in ppm, deadline in tick (not 0)
+static uint64_t edf_density_of(uint32_t wcet_us, uint32_t deadline)
+{
+    uint64_t window_us = (uint64_t) deadline * CUSTOM_SCHEDULER_TICK_DURATION_MS * 1000u;
+    return ((uint64_t) wcet_us * EDF_DENSITY_FULL + window_us - 1) / window_us;
+}
+
+// admit a task added with Custom_Scheduler_AddEdf again with a new period and deadline
+// (clamped to the period as when added), return 0 (ERR_SCHEDULER_OVERLOAD) if it does
+// not fit, the task is then left unchanged
+static uint8_t edf_readmit(SchedTask_Handle_t handle, uint32_t period, uint32_t *deadline)
+{
+    if (edf_density[handle] == 0)
     {
-        Custom_Err_SetStatus(ERR_SCHEDULER_EMPTYDELETE);
-        return;
+        return 1; // not accounted
+    }
+    if (period == 0)
+    {
+        Custom_Err_SetStatus(ERR_SCHEDULER_OVERLOAD);
+        return 0;
+    }
+    if (*deadline == 0 || *deadline > period)
+    {
+        *deadline = period;
     }
 
-    for (size_t i = 0; i < task_count; i++)
+    uint64_t density = edf_density_of(edf_wcet_us[handle], *deadline);
+    if (density > EDF_DENSITY_FULL - (edf_density_total - edf_density[handle]))
     {
-        if (bin_heap[i].taskID == ID)
-        {
-            // found the task, delete it from heap
-            Custom_PQueue_Delete(bin_heap, CUSTOM_SCHEDULER_BIHEAP_SIZE, sizeof(SchedTask_t),
-                    task_count, i, Custom_SchedTask_Compare_Smaller);
-            task_count--;
-            return;
-        }
+        Custom_Err_SetStatus(ERR_SCHEDULER_OVERLOAD);
+        return 0;
     }
+    edf_density_total = edf_density_total - edf_density[handle] + (uint32_t) density;
+    edf_density[handle] = (uint32_t) density;
+    return 1;
 }
 
-void Custom_Scheduler_Dispatch()
+SchedTask_Handle_t Custom_Scheduler_AddEdf(SchedTask_Func_t pTask, void *pArg,
+        uint32_t period, uint32_t deadline, uint32_t wcet_us, uint8_t ID)
 {
-    if (task_count == 0)
+    if (period == 0)
     {
-        // go back to sleep
-        HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
-        return;
+        // the density of a task without period is not bounded
+        Custom_Err_SetStatus(ERR_SCHEDULER_OVERLOAD);
+        return CUSTOM_SCHEDULER_HANDLE_NONE;
     }
-
-    // search the top of binary heap
-    // if found task that is overdue, run it and update task record
-    defer_tick_update = 1; // start of critical section
-    SchedTask_t *top = &bin_heap[0];
-    while (task_count > 0 && top->runAtTick < system_tick_count)
+    if (deadline == 0 || deadline > period)
     {
-#ifdef CUSTOM_SCHEDULER_USE_WATCHDOG
-        HAL_IWDG_Refresh(&hiwdg);
-#endif
-        // call the function (by the pointer stored), passing any argument
-        task_is_running = 1;
-        top->pTask(top->pTaskArg);
-        task_is_running = 0;
-#ifdef CUSTOM_SCHEDULER_USE_WATCHDOG
-        HAL_IWDG_Refresh(&hiwdg);
-#endif
-
-        if (top->periodTick == 0) // one-time task
-        {
-            // delete the task
-            Custom_PQueue_Pop(bin_heap, CUSTOM_SCHEDULER_BIHEAP_SIZE, sizeof(SchedTask_t),
-                    task_count, Custom_SchedTask_Compare_Smaller);
-            task_count--;
-        }
-        else
-        {
-            // if not reload the task and push it down the heap
-            increment_timestamp(&top->runAtTick, top->periodTick);
-            Custom_PQueue_PushDown(bin_heap, sizeof(SchedTask_t),
-                    task_count, Custom_SchedTask_Compare_Smaller);
-        }
+        deadline = period;
     }
-    defer_tick_update = 0;
-    if (defer_tick_update_count > 0)
+
+    // admission control
+    uint64_t density = edf_density_of(wcet_us, deadline);
+    if (density > EDF_DENSITY_FULL - edf_density_total)
     {
-        increment_timestamp(&system_tick_count, defer_tick_update_count);
-        defer_tick_update_count = 0;
+        Custom_Err_SetStatus(ERR_SCHEDULER_OVERLOAD);
+        return CUSTOM_SCHEDULER_HANDLE_NONE;
     }
 
-    // go back to sleep
-    HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+    SchedTask_Handle_t handle = add_task(pTask, pArg, 0, period, 0, deadline, ID);
+    if (handle != CUSTOM_SCHEDULER_HANDLE_NONE)
+    {
+        edf_density[handle] = (uint32_t) density;
+        edf_wcet_us[handle] = wcet_us;
+        edf_density_total += (uint32_t) density;
+    }
+    return handle;
 }
 
-// increment timestamp (with check and fix overflow)
-static inline void increment_timestamp(uint32_t volatile *ts, uint32_t amount)
+void Custom_Scheduler_SetDeadline(SchedTask_Handle_t handle, uint32_t deadline)
 {
-    uint32_t limit = UINT32_MAX - amount;
-    if (*ts > limit)
+    TaskLocation_t where;
+    SchedKey_t *key = get_key(handle, &where);
+    if (where == TASK_NOT_FOUND)
     {
-        fix_all_timestamp_overflow();
+        Custom_Err_SetStatus(ERR_SCHEDULER_INVALIDHANDLE);
+        return;
     }
-    *ts += amount;
-}
+    if (!edf_readmit(handle, task_slot[handle].periodTick, &deadline))
+    {
+        return;
+    }
+
+    task_slot[handle].deadlineTick = deadline;
+    if (key != NULL)
+    {
+        key->deadlineTick = deadline;
+    }
+    if (where == TASK_READY)
+    {
+        // the deadline only matter for the order of ready task
+        Custom_PQueue_LocUpdate(ready_heap, sizeof(SchedKey_t), ready_count,
+                handle, &ready_loc, Custom_SchedTask_Compare_Smaller);
+    }
+}
+
+uint32_t Custom_Scheduler_GetUtilization(void)
+{
+    return edf_density_total;
+}
+#endif
+
+SchedTask_Handle_t Custom_Scheduler_AddEvent(SchedTask_Func_t pTask, void *pArg,
+        uint8_t priority, uint8_t ID)
+{
+    if (task_count == CUSTOM_SCHEDULER_BIHEAP_SIZE)
+    {
+        Custom_Err_SetStatus(ERR_SCHEDULER_FULLADD);
+        return CUSTOM_SCHEDULER_HANDLE_NONE;
+    }
+
+    // the task is only given a slot, it have no key until it is signaled
+    SchedTask_Handle_t handle = allocate_handle();
+    SchedTask_t *slot = &task_slot[handle];
+    slot->pTask = pTask;
+    slot->pTaskArg = pArg;
+    slot->periodTick = 0;
+    slot->taskID = ID;
+    slot->priority = priority;
+    slot->isEvent = 1;
+    slot->isSignaled = 0;
+#ifdef CUSTOM_SCHEDULER_POLICY_EDF
+    slot->deadlineTick = 0;
+#endif
+    task_count++;
+    clear_stat(handle);
+    task_stat[handle].policy = CUSTOM_SCHEDULER_DEFAULT_OVERRUN_POLICY;
+    task_stat[handle].budget_tick = 0;
+    task_stat[handle].cost_us = 0;
+
+    CUSTOM_TRACE(TRACE_EVENT_TASK_ADD, handle, ID);
+    return handle;
+}
+
+void Custom_Scheduler_Signal(SchedTask_Handle_t handle)
+{
+#ifdef CUSTOM_SCHEDULER_USE_URGENT_BAND
+    if (CUSTOM_SCHEDULER_IS_URGENT_HANDLE(handle))
+    {
+        size_t index = handle - CUSTOM_SCHEDULER_BIHEAP_SIZE;
+        uint32_t primask = Custom_Critical_Enter();
+        if (urgent_task[index].pTask != NULL)
+        {
+            release_urgent(index);
+        }
+        Custom_Critical_Exit(primask);
+        return;
+    }
+#endif
+    if (handle >= CUSTOM_SCHEDULER_BIHEAP_SIZE)
+    {
+        Custom_Err_SetStatus(ERR_SCHEDULER_INVALIDHANDLE);
+        return;
+    }
+
+    uint32_t primask = Custom_Critical_Enter();
+    SchedTask_t *slot = &task_slot[handle];
+    if (slot->pTask != NULL && !slot->isSignaled)
+    {
+        slot->isSignaled = 1;
+        Custom_CirBuff_Insert(signal_queue, CUSTOM_SCHEDULER_BIHEAP_SIZE,
+                sizeof(SchedTask_Handle_t), &signal_head, (size_t*) &signal_count, &handle);
+    }
+    Custom_Critical_Exit(primask);
+}
+
+void Custom_Scheduler_Delete(uint8_t ID)
+{
+    if (task_count == 0)
+    {
+        Custom_Err_SetStatus(ERR_SCHEDULER_EMPTYDELETE);
+        return;
+    }
+
+    for (SchedTask_Handle_t handle = 0; handle < handle_unused; handle++)
+    {
+        TaskLocation_t where;
+        get_key(handle, &where);
+        if (task_slot[handle].taskID == ID && where != TASK_NOT_FOUND)
+        {
+            // found the task, delete it
+            Custom_Scheduler_DeleteHandle(handle);
+            return;
+        }
+    }
+}
+
+void Custom_Scheduler_DeleteHandle(SchedTask_Handle_t handle)
+{
+#ifdef CUSTOM_SCHEDULER_USE_URGENT_BAND
+    if (CUSTOM_SCHEDULER_IS_URGENT_HANDLE(handle))
+    {
+        SchedUrgentTask_t *task = &urgent_task[handle - CUSTOM_SCHEDULER_BIHEAP_SIZE];
+        if (task->pTask == NULL)
+        {
+            Custom_Err_SetStatus(ERR_SCHEDULER_INVALIDHANDLE);
+            return;
+        }
+        CUSTOM_TRACE(TRACE_EVENT_TASK_DELETE, handle, task->taskID);
+        uint32_t primask = Custom_Critical_Enter();
+        task->pTask = NULL;
+        task->isReleased = 0;
+        Custom_Critical_Exit(primask);
+        return;
+    }
+#endif
+    if (task_count == 0)
+    {
+        Custom_Err_SetStatus(ERR_SCHEDULER_EMPTYDELETE);
+        return;
+    }
+
+    TaskLocation_t where;
+    get_key(handle, &where);
+    if (where != TASK_NOT_FOUND)
+    {
+        CUSTOM_TRACE(TRACE_EVENT_TASK_DELETE, handle, task_slot[handle].taskID);
+    }
+    switch (where)
+    {
+    case TASK_WAITING:
+        Custom_PQueue_LocRemove(bin_heap, CUSTOM_SCHEDULER_BIHEAP_SIZE, sizeof(SchedKey_t),
+                wait_count, handle, &task_loc, compare_run_later);
+        wait_count--;
+        release_handle(handle);
+        break;
+    case TASK_READY:
+        Custom_PQueue_LocRemove(ready_heap, CUSTOM_SCHEDULER_BIHEAP_SIZE, sizeof(SchedKey_t),
+                ready_count, handle, &ready_loc, Custom_SchedTask_Compare_Smaller);
+        ready_count--;
+        release_handle(handle);
+        break;
+    case TASK_RUNNING:
+        // the handle is released after the task return
+        running_is_deleted = 1;
+        break;
+    case TASK_IDLE:
+        release_handle(handle);
+        break;
+    default:
+        Custom_Err_SetStatus(ERR_SCHEDULER_INVALIDHANDLE);
+        break;
+    }
+}
+
+void Custom_Scheduler_SetPriority(SchedTask_Handle_t handle, uint8_t priority)
+{
+    TaskLocation_t where;
+    SchedKey_t *key = get_key(handle, &where);
+    if (where == TASK_NOT_FOUND)
+    {
+        Custom_Err_SetStatus(ERR_SCHEDULER_INVALIDHANDLE);
+        return;
+    }
+
+    task_slot[handle].priority = priority;
+    if (key != NULL)
+    {
+        key->priority = priority;
+    }
+    if (where == TASK_READY)
+    {
+        // priority only matter for the order of ready task
+        Custom_PQueue_LocUpdate(ready_heap, sizeof(SchedKey_t), ready_count,
+                handle, &ready_loc, Custom_SchedTask_Compare_Smaller);
+    }
+}
+
+void Custom_Scheduler_Reschedule(SchedTask_Handle_t handle, uint32_t period, uint32_t delay)
+{
+    TaskLocation_t where;
+    SchedKey_t *key = get_key(handle, &where);
+    if (where == TASK_NOT_FOUND)
+    {
+        Custom_Err_SetStatus(ERR_SCHEDULER_INVALIDHANDLE);
+        return;
+    }
+#ifdef CUSTOM_SCHEDULER_POLICY_EDF
+    // a shorter period may bring the deadline (and the density) with it
+    uint32_t deadline = task_slot[handle].deadlineTick;
+    if (!edf_readmit(handle, period, &deadline))
+    {
+        return;
+    }
+    task_slot[handle].deadlineTick = deadline;
+    if (key != NULL)
+    {
+        key->deadlineTick = deadline;
+    }
+#endif
+
+    task_slot[handle].periodTick = period;
+    if (where == TASK_IDLE)
+    {
+        // idle event task get a key, and wait like any other task
+        SchedKey_t new_key = make_key(handle, system_tick_count);
+        increment_timestamp(&new_key.runAtTick, delay);
+        add_waiting(&new_key);
+        return;
+    }
+
+    key->runAtTick = system_tick_count;
+    increment_timestamp(&key->runAtTick, delay);
+    switch (where)
+    {
+    case TASK_WAITING:
+        Custom_PQueue_LocUpdate(bin_heap, sizeof(SchedKey_t), wait_count,
+                handle, &task_loc, compare_run_later);
+        break;
+    case TASK_READY:
+        // no longer due, move it back to the waiting heap
+        {
+            SchedKey_t moved_key = *key;
+            Custom_PQueue_LocRemove(ready_heap, CUSTOM_SCHEDULER_BIHEAP_SIZE,
+                    sizeof(SchedKey_t), ready_count, handle, &ready_loc,
+                    Custom_SchedTask_Compare_Smaller);
+            ready_count--;
+            add_waiting(&moved_key);
+        }
+        break;
+    case TASK_RUNNING:
+        // put back as is after the task return
+        running_is_rescheduled = 1;
+        break;
+    default:
+        break;
+    }
+}
+
+void Custom_Scheduler_SetOverrunPolicy(SchedTask_Handle_t handle, SchedOverrunPolicy_t policy)
+{
+    // statistic are kept in the slot array, valid even before the scheduler start
+    if (!task_exists(handle))
+    {
+        Custom_Err_SetStatus(ERR_SCHEDULER_INVALIDHANDLE);
+        return;
+    }
+    task_stat[handle].policy = policy;
+}
+
+uint8_t Custom_Scheduler_GetStat(SchedTask_Handle_t handle, SchedTaskStat_t *stat)
+{
+    // statistic are kept in the slot array, valid even before the scheduler start
+    if (!task_exists(handle))
+    {
+        return 0;
+    }
+    *stat = task_stat[handle];
+    return 1;
+}
+
+void Custom_Scheduler_ClearStat(SchedTask_Handle_t handle)
+{
+    // statistic are kept in the slot array, valid even before the scheduler start
+    if (!task_exists(handle))
+    {
+        Custom_Err_SetStatus(ERR_SCHEDULER_INVALIDHANDLE);
+        return;
+    }
+    clear_stat(handle);
+}
+
+void Custom_Scheduler_Chain(SchedTask_Handle_t handle, SchedTask_Handle_t next)
+{
+    if (!task_exists(handle) || next == handle
+            || (next != CUSTOM_SCHEDULER_HANDLE_NONE && !task_exists(next)))
+    {
+        Custom_Err_SetStatus(ERR_SCHEDULER_INVALIDHANDLE);
+        return;
+    }
+    chain_unlink(handle);
+    if (next != CUSTOM_SCHEDULER_HANDLE_NONE)
+    {
+        // a task is the next stage of one task at most, the previous link is replaced
+        if (chain_prev[next] != CUSTOM_SCHEDULER_HANDLE_NONE)
+        {
+            chain_next[chain_prev[next]] = CUSTOM_SCHEDULER_HANDLE_NONE;
+        }
+        chain_prev[next] = handle;
+        chain_next[handle] = next;
+    }
+}
+
+void Custom_Scheduler_Output(void *data)
+{
+    if (!task_is_running)
+    {
+        Custom_Err_SetStatus(ERR_SCHEDULER_INVALIDHANDLE);
+        return;
+    }
+    running_output = data;
+    running_has_output = 1;
+}
+
+void *Custom_Scheduler_GetInput(void)
+{
+    if (!task_is_running)
+    {
+        return NULL;
+    }
+    void *data = chain_input[running_key.slot];
+    chain_input[running_key.slot] = NULL;
+    return data;
+}
+
+void Custom_Scheduler_SetCost(SchedTask_Handle_t handle, uint16_t cost_us)
+{
+    if (!task_exists(handle))
+    {
+        Custom_Err_SetStatus(ERR_SCHEDULER_INVALIDHANDLE);
+        return;
+    }
+    task_stat[handle].cost_us = cost_us;
+}
+
+// weight of a task when spreading the phase
+static uint32_t phase_cost(SchedTask_Handle_t handle)
+{
+    const SchedTaskStat_t *stat = &task_stat[handle];
+    if (stat->cost_us > 0)
+    {
+        return stat->cost_us;
+    }
+    return (stat->max_run_us > 0) ? stat->max_run_us : 1u;
+}
+
+// start of the phase horizon: the next tick (tick 0 before the scheduler start)
+static uint32_t phase_start(void)
+{
+    return scheduler_is_running ? current_tick() + 1u : 0u;
+}
+
+// add the load of a periodic task first released at the provided tick of the horizon
+static void phase_add(uint32_t first, uint32_t period, uint32_t cost)
+{
+    for (uint32_t t = first; t < CUSTOM_SCHEDULER_PHASE_HORIZON; t += period)
+    {
+        phase_load[t] += cost;
+    }
+}
+
+// highest load over the tick the task would be released on, if first released at the
+// provided tick of the horizon
+static uint32_t phase_peak(uint32_t first, uint32_t period, uint32_t cost)
+{
+    uint32_t peak = 0;
+    for (uint32_t t = first; t < CUSTOM_SCHEDULER_PHASE_HORIZON; t += period)
+    {
+        if (phase_load[t] + cost > peak)
+        {
+            peak = phase_load[t] + cost;
+        }
+    }
+    return peak;
+}
+
+// next release of a periodic task (relative to the horizon start), if in the horizon
+static uint8_t phase_next_release(const SchedKey_t *key, uint8_t has_run, uint32_t start,
+        uint32_t *first)
+{
+    uint32_t period = task_slot[key->slot].periodTick;
+    if (period == 0)
+    {
+        return 0;
+    }
+    uint32_t release = key->runAtTick;
+    if (has_run)
+    {
+        // ready or running: released again one period after this run
+        release += period;
+    }
+    while (release < start)
+    {
+        release += period; // overdue, the next release that come in the horizon
+    }
+    *first = release - start;
+    return (*first < CUSTOM_SCHEDULER_PHASE_HORIZON);
+}
+
+// compute the load per tick, of every task if include_waiting is set, otherwise only of
+// the task ready or running (that keep their phase)
+static void phase_compute(uint32_t start, uint8_t include_waiting)
+{
+    uint32_t first;
+    memset(phase_load, 0, sizeof(phase_load));
+    for (size_t i = 0; include_waiting && i < wait_count; i++)
+    {
+        if (phase_next_release(&bin_heap[i], 0, start, &first))
+        {
+            phase_add(first, task_slot[bin_heap[i].slot].periodTick,
+                    phase_cost(bin_heap[i].slot));
+        }
+    }
+    for (size_t i = 0; i < ready_count; i++)
+    {
+        if (phase_next_release(&ready_heap[i], 1, start, &first))
+        {
+            phase_add(first, task_slot[ready_heap[i].slot].periodTick,
+                    phase_cost(ready_heap[i].slot));
+        }
+    }
+    if (task_is_running && !running_is_deleted
+            && phase_next_release(&running_key, 1, start, &first))
+    {
+        phase_add(first, task_slot[running_key.slot].periodTick,
+                phase_cost(running_key.slot));
+    }
+}
+
+static void phase_summary(SchedPhaseLoad_t *load)
+{
+    memset(load, 0, sizeof(SchedPhaseLoad_t));
+    for (uint16_t t = 0; t < CUSTOM_SCHEDULER_PHASE_HORIZON; t++)
+    {
+        if (phase_load[t] > load->peakUs)
+        {
+            load->peakUs = phase_load[t];
+            load->peakTick = t;
+        }
+        if (phase_load[t] > 0)
+        {
+            load->busyTick++;
+        }
+        load->totalUs += phase_load[t];
+    }
+}
+
+void Custom_Scheduler_SpreadPhase(void)
+{
+    uint32_t start = phase_start();
+    phase_compute(start, 1);
+    phase_summary(&phase_report.before);
+
+    // the task ready or running keep their phase, place the waiting one around them
+    phase_compute(start, 0);
+    phase_report.moved = 0;
+    static uint8_t placed[CUSTOM_SCHEDULER_BIHEAP_SIZE];
+    memset(placed, 0, wait_count);
+    while (1)
+    {
+        // heaviest waiting periodic task not placed yet, shortest period first on tie
+        size_t next = wait_count;
+        for (size_t i = 0; i < wait_count; i++)
+        {
+            SchedTask_Handle_t handle = bin_heap[i].slot;
+            if (placed[i] || task_slot[handle].periodTick == 0)
+            {
+                continue;
+            }
+            if (next == wait_count || phase_cost(handle) > phase_cost(bin_heap[next].slot)
+                    || (phase_cost(handle) == phase_cost(bin_heap[next].slot)
+                            && task_slot[handle].periodTick
+                                    < task_slot[bin_heap[next].slot].periodTick))
+            {
+                next = i;
+            }
+        }
+        if (next == wait_count)
+        {
+            break;
+        }
+        placed[next] = 1;
+
+        // the first tick within a period which keep the peak lowest
+        SchedKey_t *key = &bin_heap[next];
+        uint32_t period = task_slot[key->slot].periodTick;
+        uint32_t cost = phase_cost(key->slot);
+        uint32_t best = 0;
+        uint32_t best_peak = UINT32_MAX;
+        for (uint32_t first = 0; first < period && first < CUSTOM_SCHEDULER_PHASE_HORIZON;
+                first++)
+        {
+            uint32_t peak = phase_peak(first, period, cost);
+            if (peak < best_peak)
+            {
+                best_peak = peak;
+                best = first;
+            }
+        }
+        phase_add(best, period, cost);
+        key->runAtTick = start;
+        increment_timestamp(&key->runAtTick, best);
+        phase_report.moved++;
+    }
+
+    if (scheduler_is_running)
+    {
+        // every key may have moved, build the waiting heap again
+        Custom_PQueue_LocCreate(bin_heap, CUSTOM_SCHEDULER_BIHEAP_SIZE, sizeof(SchedKey_t),
+                wait_count, &task_loc, compare_run_later);
+    }
+    phase_summary(&phase_report.after);
+    phase_report_valid = 1;
+}
+
+uint8_t Custom_Scheduler_GetPhaseReport(SchedPhaseReport_t *report)
+{
+    if (!phase_report_valid)
+    {
+        return 0;
+    }
+    *report = phase_report;
+    return 1;
+}
+
+void Custom_Scheduler_GetPhaseLoad(SchedPhaseLoad_t *load, uint32_t *profile)
+{
+    phase_compute(phase_start(), 1);
+    phase_summary(load);
+    if (profile != NULL)
+    {
+        memcpy(profile, phase_load, sizeof(phase_load));
+    }
+}
+
+void Custom_Scheduler_SetBudget(SchedTask_Handle_t handle, uint16_t budget_tick,
+        SchedBudgetAction_t action)
+{
+    if (!task_exists(handle))
+    {
+        Custom_Err_SetStatus(ERR_SCHEDULER_INVALIDHANDLE);
+        return;
+    }
+    task_stat[handle].budget_tick = budget_tick;
+    task_stat[handle].budget_action = action;
+}
+
+uint8_t Custom_Scheduler_GetBudgetRecord(SchedBudgetRecord_t *record)
+{
+    uint32_t primask = Custom_Critical_Enter();
+    uint8_t valid = (budget_record.magic == CUSTOM_SCHEDULER_BUDGET_MAGIC);
+    if (valid)
+    {
+        *record = budget_record;
+    }
+    Custom_Critical_Exit(primask);
+    return valid;
+}
+
+void Custom_Scheduler_ClearBudgetRecord(void)
+{
+    budget_record.magic = 0;
+}
+
+#ifdef CUSTOM_SCHEDULER_USE_URGENT_BAND
+SchedTask_Handle_t Custom_Scheduler_AddUrgent(SchedTask_Func_t pTask, void *pArg,
+        uint8_t priority, uint32_t period, uint8_t ID)
+{
+    for (size_t i = 0; i < CUSTOM_SCHEDULER_URGENT_SIZE; i++)
+    {
+        SchedUrgentTask_t *task = &urgent_task[i];
+        if (task->pTask != NULL)
+        {
+            continue;
+        }
+
+        SchedTask_Handle_t handle = CUSTOM_SCHEDULER_BIHEAP_SIZE + i;
+        uint32_t primask = Custom_Critical_Enter();
+        task->pTaskArg = pArg;
+        task->periodTick = period;
+        task->countdownTick = period;
+        task->taskID = ID;
+        task->priority = priority;
+        task->isReleased = 0;
+        memset(&urgent_stat[i], 0, sizeof(SchedUrgentStat_t));
+        task->pTask = pTask; // in use from here
+        Custom_Critical_Exit(primask);
+
+        CUSTOM_TRACE(TRACE_EVENT_TASK_ADD, handle, ID);
+        return handle;
+    }
+
+    Custom_Err_SetStatus(ERR_SCHEDULER_FULLADD);
+    return CUSTOM_SCHEDULER_HANDLE_NONE;
+}
+
+void Custom_Scheduler_RunUrgent(void)
+{
+    while (1)
+    {
+        // take the released task with highest priority
+        size_t next = CUSTOM_SCHEDULER_URGENT_SIZE;
+        uint32_t primask = Custom_Critical_Enter();
+        for (size_t i = 0; i < CUSTOM_SCHEDULER_URGENT_SIZE; i++)
+        {
+            if (urgent_task[i].pTask != NULL && urgent_task[i].isReleased
+                    && (next == CUSTOM_SCHEDULER_URGENT_SIZE
+                            || urgent_task[i].priority > urgent_task[next].priority))
+            {
+                next = i;
+            }
+        }
+        if (next == CUSTOM_SCHEDULER_URGENT_SIZE)
+        {
+            Custom_Critical_Exit(primask);
+            return;
+        }
+        SchedUrgentTask_t *task = &urgent_task[next];
+        task->isReleased = 0;
+        Custom_Critical_Exit(primask);
+
+        SchedUrgentStat_t *stat = &urgent_stat[next];
+        uint32_t latency = Custom_Timestamp_GetUs() - task->releaseUs;
+        if (latency > stat->maxLatencyUs)
+        {
+            stat->maxLatencyUs = latency;
+        }
+        stat->run++;
+
+        SchedTask_Handle_t handle = CUSTOM_SCHEDULER_BIHEAP_SIZE + next;
+        CUSTOM_TRACE(TRACE_EVENT_TASK_START, handle, task->taskID);
+        task->pTask(task->pTaskArg);
+        CUSTOM_TRACE(TRACE_EVENT_TASK_END, handle, task->taskID);
+    }
+}
+
+uint8_t Custom_Scheduler_GetUrgentStat(SchedTask_Handle_t handle, SchedUrgentStat_t *stat)
+{
+    if (!CUSTOM_SCHEDULER_IS_URGENT_HANDLE(handle)
+            || urgent_task[handle - CUSTOM_SCHEDULER_BIHEAP_SIZE].pTask == NULL)
+    {
+        return 0;
+    }
+    uint32_t primask = Custom_Critical_Enter();
+    *stat = urgent_stat[handle - CUSTOM_SCHEDULER_BIHEAP_SIZE];
+    Custom_Critical_Exit(primask);
+    return 1;
+}
+#endif
+
+#ifdef CUSTOM_SCHEDULER_USE_CYCLIC
+void Custom_Scheduler_GetCyclicStat(SchedCyclicStat_t *stat)
+{
+    *stat = cyclic_stat;
+}
+#endif
+
+void Custom_Scheduler_Dispatch()
+{
+#ifdef CUSTOM_SCHEDULER_USE_CYCLIC
+    run_cyclic();
+#endif
+    if (task_count == 0)
+    {
+        // go back to sleep
+        enter_sleep();
+        return;
+    }
+
+    defer_tick_update = 1; // start of critical section
+    while (1)
+    {
+#ifdef CUSTOM_SCHEDULER_USE_CYCLIC
+        // the frame of the table go before the task of the heap
+        run_cyclic();
+#endif
+        if (ready_count == 0)
+        {
+            // move every task that is overdue from the waiting heap to the ready heap
+            // in one go, then order them by priority
+            SchedKey_t due_key = { .runAtTick = system_tick_count };
+            ready_count = Custom_PQueue_LocPopAbove(bin_heap, CUSTOM_SCHEDULER_BIHEAP_SIZE,
+                    sizeof(SchedKey_t), wait_count, &due_key, ready_heap, &task_loc,
+                    compare_run_later);
+            wait_count -= ready_count;
+            Custom_PQueue_LocCreate(ready_heap, CUSTOM_SCHEDULER_BIHEAP_SIZE,
+                    sizeof(SchedKey_t), ready_count, &ready_loc,
+                    Custom_SchedTask_Compare_Smaller);
+        }
+        // signaled task join the ready heap, and are run in priority order with the rest
+        move_signaled_to_ready();
+        if (ready_count == 0)
+        {
+            break;
+        }
+
+        // run the ready task with highest priority
+        running_key = ready_heap[0];
+        Custom_PQueue_LocPop(ready_heap, CUSTOM_SCHEDULER_BIHEAP_SIZE, sizeof(SchedKey_t),
+                ready_count, &ready_loc, Custom_SchedTask_Compare_Smaller);
+        ready_count--;
+        running_is_deleted = 0;
+        running_is_rescheduled = 0;
+        running_has_output = 0;
+        SchedTask_t *slot = &task_slot[running_key.slot];
+
+#ifdef CUSTOM_SCHEDULER_USE_WATCHDOG
+        HAL_IWDG_Refresh(&hiwdg);
+#endif
+        // call the function (by the pointer stored), passing any argument
+        running_tick = 0;
+        running_over_budget = 0;
+        task_is_running = 1;
+        uint32_t now = current_tick();
+        if (now > running_key.runAtTick)
+        {
+            record_lateness(running_key.slot, now - running_key.runAtTick);
+        }
+        else
+        {
+            record_lateness(running_key.slot, 0);
+        }
+        CUSTOM_TRACE(TRACE_EVENT_TASK_START, running_key.slot, slot->taskID);
+        CUSTOM_CPULOAD_TASK_BEGIN();
+        uint32_t run_start = Custom_Timestamp_GetUs();
+        slot->pTask(slot->pTaskArg);
+        record_run_time(running_key.slot, Custom_Timestamp_GetUs() - run_start);
+        CUSTOM_CPULOAD_TASK_END();
+        CUSTOM_TRACE(TRACE_EVENT_TASK_END, running_key.slot, slot->taskID);
+#ifdef CUSTOM_SCHEDULER_USE_WATCHDOG
+        HAL_IWDG_Refresh(&hiwdg);
+#endif
+
+        if (running_over_budget)
+        {
+            count_saturate(&task_stat[running_key.slot].over_budget, 1);
+        }
+        if (running_has_output && !running_is_deleted)
+        {
+            // the next stage run in this same pass, no polling and no signal
+            hand_off_output();
+        }
+
+        // the task may have deleted or rescheduled itself while running
+        if (running_is_deleted)
+        {
+            release_handle(running_key.slot);
+        }
+        else if (running_is_rescheduled)
+        {
+            // put back as is
+            add_waiting(&running_key);
+        }
+        else if (slot->periodTick > 0)
+        {
+            // reload the task and put it back to the waiting heap
+            reload_periodic(&running_key, slot->periodTick);
+            if (running_over_budget
+                    && task_stat[running_key.slot].budget_action == SCHED_BUDGET_SKIP)
+            {
+                count_saturate(&task_stat[running_key.slot].skipped, 1);
+                increment_timestamp(&running_key.runAtTick, slot->periodTick);
+            }
+            add_waiting(&running_key);
+        }
+        else if (slot->isEvent)
+        {
+            // event task go back to idle, waiting for the next signal
+        }
+        else
+        {
+            // one-time task, delete it
+            release_handle(running_key.slot);
+        }
+        task_is_running = 0;
+    }
+    defer_tick_update = 0;
+    if (defer_tick_update_count > 0)
+    {
+        increment_timestamp(&system_tick_count, defer_tick_update_count);
+        defer_tick_update_count = 0;
+    }
+
+    // go back to sleep
+    Custom_Trace_Idle();
+    enter_sleep();
+}
+
+// increment timestamp (with check and fix overflow)
+static inline void increment_timestamp(uint32_t volatile *ts, uint32_t amount)
+{
+    uint32_t limit = UINT32_MAX - amount;
+    if (*ts > limit)
+    {
+        fix_all_timestamp_overflow();
+    }
+    *ts += amount;
+}
+
+// find the smallest timestamp within an array of key
+static uint32_t find_min_timestamp(const SchedKey_t *arr, size_t count, uint32_t min_ts)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (arr[i].runAtTick < min_ts)
+        {
+            min_ts = arr[i].runAtTick;
+        }
+    }
+    return min_ts;
+}
+
+// shift timestamp of all key within an array of key
+static void shift_timestamp(SchedKey_t *arr, size_t count, uint32_t amount)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        arr[i].runAtTick -= amount;
+    }
+}
 
 // fix timestamp for all task (runAtTick) and system_tick_count when overflow occur
 static void fix_all_timestamp_overflow()
 {
     // find the smallest timestamp
     uint32_t min_ts = system_tick_count;
-    for (size_t i = 0; i < task_count; i++)
+    min_ts = find_min_timestamp(bin_heap, wait_count, min_ts);
+    min_ts = find_min_timestamp(ready_heap, ready_count, min_ts);
+    if (task_is_running)
     {
-        if (bin_heap[i].runAtTick < min_ts)
-        {
-            min_ts = bin_heap[i].runAtTick;
-        }
+        min_ts = find_min_timestamp(&running_key, 1, min_ts);
     }
 
     // shift all timestamp relatively such that the smallest time stamp is now 0
-    for (size_t i = 0; i < task_count; i++)
+    shift_timestamp(bin_heap, wait_count, min_ts);
+    shift_timestamp(ready_heap, ready_count, min_ts);
+    if (task_is_running)
     {
-        bin_heap[i].runAtTick -= min_ts;
+        shift_timestamp(&running_key, 1, min_ts);
     }
 
     // shift the system_tick_count by that amount too
     system_tick_count -= min_ts;
 }
-
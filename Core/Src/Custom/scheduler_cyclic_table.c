@@ -0,0 +1,48 @@
+/*
+ * scheduler_cyclic_table.c
+ *
+ * Generated by Tools/cyclic_gen.py from Tools/cyclic_taskset.json, do not edit.
+ * major frame 500 ms, minor frame 500 ms (1 frame), utilization 0.004%,
+ * worst frame 20 us
+ */
+
+#include "Custom/scheduler.h"
+
+#ifdef CUSTOM_SCHEDULER_USE_CYCLIC
+
+void task_blink_led(void *param);
+
+#define CYCLIC_MINOR_TICK 50u
+#define CYCLIC_MINOR_US 500000u
+#define CYCLIC_FRAME_COUNT 1u
+
+_Static_assert(CUSTOM_SCHEDULER_TICK_DURATION_MS == 10,
+        "table generated for another tick, run Tools/cyclic_gen.py again");
+
+// estimated worst case execution time, in us
+#define CYCLIC_WCET_BLINK_LED 20u
+
+static const SchedCyclicEntry_t cyclic_entry[] =
+{
+    // frame 0
+    { task_blink_led, NULL, 0 },
+};
+
+static const SchedCyclicFrame_t cyclic_frame[CYCLIC_FRAME_COUNT] =
+{
+    { 0, 1 },
+};
+
+_Static_assert(sizeof(cyclic_entry) / sizeof(cyclic_entry[0]) == 1,
+        "entry count does not match the frame");
+_Static_assert(CYCLIC_WCET_BLINK_LED <= CYCLIC_MINOR_US, "frame 0 overloaded");
+
+const SchedCyclicTable_t sched_cyclic_table =
+{
+    .minorTick = CYCLIC_MINOR_TICK,
+    .frameCount = CYCLIC_FRAME_COUNT,
+    .frame = cyclic_frame,
+    .entry = cyclic_entry,
+};
+
+#endif
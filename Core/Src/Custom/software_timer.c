@@ -6,6 +6,8 @@
  */
 
 #include "Custom/software_timer.h"
+#include "Custom/scheduler.h"
+#include "Custom/timestamp.h"
 
 // since timer will be update every tick duration, it can only register
 // event with the smallest time scale of tick duration (in this case TIMER_TICK_DURATION_MS)
@@ -33,3 +35,201 @@ uint8_t Custom_SoftTimer_IsSet(volatile SoftTimer_t *tm)
 {
 	return (tm->timer_flag == TIMER_FLAG_SET);
 }
+
+// timer service (timing wheel)
+
+#define WHEEL_MASK (CUSTOM_SOFTTIMER_WHEEL_SIZE - 1u)
+
+_Static_assert((CUSTOM_SOFTTIMER_WHEEL_SIZE & WHEEL_MASK) == 0,
+		"CUSTOM_SOFTTIMER_WHEEL_SIZE must be a power of 2");
+
+// slot i hold the timer with (expire_tick % CUSTOM_SOFTTIMER_WHEEL_SIZE) == i
+static SoftTimerEntry_t *wheel[CUSTOM_SOFTTIMER_WHEEL_SIZE];
+// incremented by the tick ISR
+static uint32_t volatile wheel_tick = 0;
+// last tick whose slot was processed by the service task
+static uint32_t service_tick = 0;
+static SchedTask_Handle_t service_task = CUSTOM_SCHEDULER_HANDLE_NONE;
+
+static void wheel_link(SoftTimerEntry_t *tm)
+{
+	SoftTimerEntry_t **head = &wheel[tm->expire_tick & WHEEL_MASK];
+
+	tm->prev = NULL;
+	tm->next = *head;
+	if (*head != NULL)
+	{
+		(*head)->prev = tm;
+	}
+	*head = tm;
+	tm->state = TIMER_STATE_ARMED;
+
+	// the tick ISR may have passed the expire tick before the timer was linked
+	if ((int32_t) (wheel_tick - tm->expire_tick) >= 0)
+	{
+		Custom_Scheduler_Signal(service_task);
+	}
+}
+
+static void wheel_unlink(SoftTimerEntry_t *tm)
+{
+	if (tm->prev != NULL)
+	{
+		tm->prev->next = tm->next;
+	}
+	else
+	{
+		wheel[tm->expire_tick & WHEEL_MASK] = tm->next;
+	}
+	if (tm->next != NULL)
+	{
+		tm->next->prev = tm->prev;
+	}
+	tm->next = NULL;
+	tm->prev = NULL;
+}
+
+// fire every timer of the slot of that tick which is due
+static void fire_slot(uint32_t tick)
+{
+	SoftTimerEntry_t *fire_list = NULL;
+	SoftTimerEntry_t *tm = wheel[tick & WHEEL_MASK];
+
+	// take out the due timer first, so callback can start and stop any timer
+	while (tm != NULL)
+	{
+		SoftTimerEntry_t *next = tm->next;
+		if ((int32_t) (tick - tm->expire_tick) >= 0)
+		{
+			wheel_unlink(tm);
+			tm->state = TIMER_STATE_FIRING;
+			tm->fire_next = fire_list;
+			fire_list = tm;
+		}
+		tm = next;
+	}
+
+	while (fire_list != NULL)
+	{
+		tm = fire_list;
+		fire_list = tm->fire_next;
+		if (tm->state != TIMER_STATE_FIRING)
+		{
+			continue; // stopped or started again by a previous callback
+		}
+
+		tm->state = TIMER_STATE_IDLE;
+		tm->flag = 1;
+		if (tm->period_tick > 0)
+		{
+			tm->expire_tick += tm->period_tick;
+			uint32_t late = wheel_tick - tm->expire_tick;
+			if ((int32_t) late >= 0)
+			{
+				// skip the missed period
+				tm->expire_tick += (late / tm->period_tick + 1u) * tm->period_tick;
+			}
+			wheel_link(tm);
+		}
+		if (tm->callback != NULL)
+		{
+			tm->callback(tm->arg);
+		}
+	}
+}
+
+static void service_run(void *param)
+{
+	uint32_t now = wheel_tick;
+
+	// every slot is visited once within a turn of the wheel, and late timer are
+	// fired anyway, so no need to go through more than one turn
+	if (now - service_tick > CUSTOM_SOFTTIMER_WHEEL_SIZE)
+	{
+		service_tick = now - CUSTOM_SOFTTIMER_WHEEL_SIZE;
+	}
+	while (service_tick != now)
+	{
+		service_tick++;
+		fire_slot(service_tick);
+	}
+}
+
+void Custom_SoftTimer_ServiceInit(void)
+{
+	for (size_t i = 0; i < CUSTOM_SOFTTIMER_WHEEL_SIZE; i++)
+	{
+		wheel[i] = NULL;
+	}
+	wheel_tick = 0;
+	service_tick = 0;
+	service_task = Custom_Scheduler_AddEvent(service_run, NULL,
+			CUSTOM_SOFTTIMER_SERVICE_PRIORITY, CUSTOM_SOFTTIMER_SERVICE_ID);
+}
+
+void Custom_SoftTimer_ServiceTick(void)
+{
+	uint32_t tick = wheel_tick + 1u;
+	wheel_tick = tick;
+	if (wheel[tick & WHEEL_MASK] != NULL && service_task != CUSTOM_SCHEDULER_HANDLE_NONE)
+	{
+		Custom_Scheduler_Signal(service_task);
+	}
+}
+
+void Custom_SoftTimer_Start(SoftTimerEntry_t *tm, uint32_t delay_tick, uint32_t period_tick,
+		SoftTimer_Callback_t callback, void *arg)
+{
+	Custom_SoftTimer_Stop(tm);
+	tm->delay_tick = (delay_tick > 0) ? delay_tick : 1u;
+	tm->period_tick = period_tick;
+	tm->callback = callback;
+	tm->arg = arg;
+	tm->flag = 0;
+	tm->expire_tick = wheel_tick + tm->delay_tick;
+	wheel_link(tm);
+}
+
+void Custom_SoftTimer_Stop(SoftTimerEntry_t *tm)
+{
+	if (tm->state == TIMER_STATE_ARMED)
+	{
+		wheel_unlink(tm);
+	}
+	tm->state = TIMER_STATE_IDLE;
+}
+
+void Custom_SoftTimer_Restart(SoftTimerEntry_t *tm)
+{
+	Custom_SoftTimer_Start(tm, tm->delay_tick, tm->period_tick, tm->callback, tm->arg);
+}
+
+uint8_t Custom_SoftTimer_IsExpired(SoftTimerEntry_t *tm)
+{
+	uint8_t flag = tm->flag;
+	tm->flag = 0;
+	return flag;
+}
+
+// deadline timer
+
+void Custom_SoftTimer_DeadlineSet(SoftDeadline_t *dl, uint32_t us)
+{
+	dl->deadline_us = Custom_Timestamp_GetUs() + us;
+}
+
+void Custom_SoftTimer_DeadlineAdvance(SoftDeadline_t *dl, uint32_t us)
+{
+	dl->deadline_us += us;
+}
+
+uint8_t Custom_SoftTimer_DeadlineIsExpired(const SoftDeadline_t *dl)
+{
+	return ((int32_t) (Custom_Timestamp_GetUs() - dl->deadline_us) >= 0);
+}
+
+uint32_t Custom_SoftTimer_DeadlineRemainingUs(const SoftDeadline_t *dl)
+{
+	int32_t remaining = (int32_t) (dl->deadline_us - Custom_Timestamp_GetUs());
+	return (remaining > 0) ? (uint32_t) remaining : 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * timestamp.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#include "Custom/timestamp.h"
+#include "Custom/critical_section.h"
+#include "tim.h"
+
+#ifndef CUSTOM_TIMESTAMP_USE_DWT
+
+_Static_assert(CUSTOM_TIMESTAMP_COUNTER_HZ == 1000000u,
+        "the timestamp timer must count in us");
+
+// number of tick (timer overflow) since start
+static uint64_t timestamp_tick = 0;
+
+void Custom_Timestamp_Init(void)
+{
+    timestamp_tick = 0;
+}
+
+void Custom_Timestamp_TickUpdate(void)
+{
+    timestamp_tick++;
+}
+
+uint64_t Custom_Timestamp_GetUs64(void)
+{
+    uint32_t primask = Custom_Critical_Enter();
+    uint64_t tick = timestamp_tick;
+    uint32_t counter = __HAL_TIM_GET_COUNTER(&CUSTOM_TIMESTAMP_TIMER);
+    if (__HAL_TIM_GET_FLAG(&CUSTOM_TIMESTAMP_TIMER, TIM_FLAG_UPDATE))
+    {
+        // overflowed but not counted yet, the counter read may be from before or
+        // after the overflow, so read it again
+        counter = __HAL_TIM_GET_COUNTER(&CUSTOM_TIMESTAMP_TIMER);
+        tick++;
+    }
+    Custom_Critical_Exit(primask);
+
+    return tick * CUSTOM_TIMESTAMP_TICK_US + counter;
+}
+
+#else
+
+// upper 32 bit of the extended cycle counter, and the last value read of the lower half
+static uint32_t cycle_high = 0;
+static uint32_t cycle_low_last = 0;
+
+static uint64_t read_cycle(void)
+{
+    uint32_t primask = Custom_Critical_Enter();
+    uint32_t low = DWT->CYCCNT;
+    if (low < cycle_low_last)
+    {
+        cycle_high++;
+    }
+    cycle_low_last = low;
+    uint64_t cycle = ((uint64_t) cycle_high << 32) | low;
+    Custom_Critical_Exit(primask);
+
+    return cycle;
+}
+
+void Custom_Timestamp_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    cycle_high = 0;
+    cycle_low_last = 0;
+}
+
+void Custom_Timestamp_TickUpdate(void)
+{
+    read_cycle();
+}
+
+uint64_t Custom_Timestamp_GetUs64(void)
+{
+    return read_cycle() / CUSTOM_TIMESTAMP_DWT_CYCLE_PER_US;
+}
+
+#endif
+
+uint32_t Custom_Timestamp_GetUs(void)
+{
+    return (uint32_t) Custom_Timestamp_GetUs64();
+}
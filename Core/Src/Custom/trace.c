@@ -0,0 +1,137 @@
+/*
+ * trace.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#include "Custom/trace.h"
+#include "Custom/scheduler.h"
+#include "Custom/timestamp.h"
+#include "usart.h"
+
+#define TRACE_MASK (CUSTOM_TRACE_SIZE - 1u)
+#define TRACE_SYNC0 (0xA5u)
+#define TRACE_SYNC1 (0x5Au)
+
+_Static_assert((CUSTOM_TRACE_SIZE & TRACE_MASK) == 0, "CUSTOM_TRACE_SIZE must be a power of 2");
+_Static_assert(sizeof(TraceRecord_t) == 12, "trace record must be 12 bytes");
+
+static TraceRecord_t trace_ring[CUSTOM_TRACE_SIZE];
+// total number of record reserved, the next one go into trace_ring[trace_head & TRACE_MASK]
+static uint32_t volatile trace_head = 0;
+// total number of record dumped (or lost)
+static uint32_t dump_tail = 0;
+static SchedTask_Handle_t dump_task = CUSTOM_SCHEDULER_HANDLE_NONE;
+
+void Custom_Trace_Record(uint16_t event, uint16_t arg0, uint32_t arg1)
+{
+    uint32_t index;
+
+    // reserve a slot, retry if another context reserved one in between
+    do
+    {
+        index = __LDREXW(&trace_head);
+    } while (__STREXW(index + 1u, &trace_head));
+
+    TraceRecord_t *record = &trace_ring[index & TRACE_MASK];
+    record->timestamp = Custom_Timestamp_GetUs();
+    record->event = event;
+    record->arg0 = arg0;
+    record->arg1 = arg1;
+}
+
+static void dump_send(const TraceRecord_t *record, uint8_t count)
+{
+    uint8_t header[3] = { TRACE_SYNC0, TRACE_SYNC1, count };
+    uint8_t checksum = 0;
+    const uint8_t *byte = (const uint8_t*) record;
+
+    for (size_t i = 0; i < count * sizeof(TraceRecord_t); i++)
+    {
+        checksum += byte[i];
+    }
+    HAL_UART_Transmit(&huart2, header, sizeof(header), 10);
+    HAL_UART_Transmit(&huart2, (uint8_t*) record, count * sizeof(TraceRecord_t), 50);
+    HAL_UART_Transmit(&huart2, &checksum, 1, 10);
+}
+
+// event task, send the next chunk of record
+static void dump_run(void *param)
+{
+    if ((HAL_UART_GetState(&huart2) & HAL_UART_STATE_BUSY_TX) == HAL_UART_STATE_BUSY_TX)
+    {
+        // a transmit by interrupt is in progress, a blocking one would fail, try again on
+        // the next tick
+        Custom_Scheduler_Reschedule(dump_task, 0, 1);
+        return;
+    }
+
+    TraceRecord_t chunk[CUSTOM_TRACE_DUMP_CHUNK];
+    uint8_t count = 0;
+    uint32_t head = trace_head;
+    uint32_t tail = dump_tail;
+
+    if (head - dump_tail > CUSTOM_TRACE_SIZE)
+    {
+        // the ring wrapped around since the last dump, the record is stamped with the
+        // time of the first record kept, so the time stay in order
+        chunk[count].timestamp = trace_ring[(head - CUSTOM_TRACE_SIZE) & TRACE_MASK].timestamp;
+        chunk[count].event = TRACE_EVENT_LOST;
+        chunk[count].arg0 = 0;
+        chunk[count].arg1 = head - CUSTOM_TRACE_SIZE - dump_tail;
+        count++;
+        dump_tail = head - CUSTOM_TRACE_SIZE;
+    }
+
+    // copy first, ISR may write new record while sending
+    uint32_t start = dump_tail;
+    while (count < CUSTOM_TRACE_DUMP_CHUNK && dump_tail != head)
+    {
+        chunk[count] = trace_ring[dump_tail & TRACE_MASK];
+        count++;
+        dump_tail++;
+    }
+    if (trace_head - start > CUSTOM_TRACE_SIZE)
+    {
+        // overwritten while being copied, start again from the same place, the next run
+        // count the overwritten record as lost
+        dump_tail = tail;
+        Custom_Scheduler_Signal(dump_task);
+        return;
+    }
+
+    if (count > 0)
+    {
+        dump_send(chunk, count);
+    }
+    if (dump_tail != head)
+    {
+        Custom_Scheduler_Signal(dump_task);
+    }
+}
+
+void Custom_Trace_Init(void)
+{
+    trace_head = 0;
+    dump_tail = 0;
+    dump_task = Custom_Scheduler_AddEvent(dump_run, NULL, CUSTOM_TRACE_DUMP_PRIORITY,
+            CUSTOM_TRACE_DUMP_ID);
+}
+
+void Custom_Trace_Dump(void)
+{
+    Custom_Scheduler_Signal(dump_task);
+}
+
+void Custom_Trace_Idle(void)
+{
+#ifdef CUSTOM_TRACE_DUMP_WHEN_IDLE
+    // wait for a full chunk, the dump task itself add a record when it start and end
+    if (dump_task != CUSTOM_SCHEDULER_HANDLE_NONE
+            && trace_head - dump_tail >= CUSTOM_TRACE_DUMP_CHUNK)
+    {
+        Custom_Scheduler_Signal(dump_task);
+    }
+#endif
+}
@@ -7,8 +7,10 @@
 
 #include "SchedTask/uart_receive_parse.h"
 #include "SchedTask/uart_send_response.h"
-#include "Custom/circular_buffer.h"
+#include "Custom/fsm.h"
+#include "Custom/mailbox.h"
 #include "Custom/scheduler.h"
+#include "Custom/trace.h"
 #include "stm32f103xb.h"
 #include "stm32f1xx_hal_uart.h"
 #include "usart.h"
@@ -17,39 +19,109 @@
 #define START_CMD_LEN (5)
 #define END_CMD ((const uint8_t*) "!OK#")
 #define END_CMD_LEN (4)
+#define TRACE_CMD ((const uint8_t*) "!TRC#")
+#define TRACE_CMD_LEN (5)
+#define STATUS_CMD ((const uint8_t*) "!STA#")
+#define STATUS_CMD_LEN (5)
 
+#define COMMAND_QUEUE_SIZE (4)
 
-static uint8_t cirbuff[BUFFER_SIZE];
-static size_t buff_head;
-static size_t buff_count;
+/*
+ * NOTE:
+ * The receive ISR post every character to the mailbox of the parse task, which wake
+ * it, so the parser only run when there is something to parse. Recognized command are
+ * posted as event to the command state machine:
+ * - COMMAND: parent of the two state below, handle "!RST#" for both of them
+ * - IDLE: nothing is sent
+ * - STREAMING: the ADC value is sent periodically (task uart_send_response)
+ * "!RST#" (re)start streaming from any state, "!OK#" stop it.
+ * "!TRC#" dump the event trace (see Custom/trace.h), "!STA#" send the CPU load, they do
+ * not affect the state.
+ * The ADC value is sent by a coroutine, started and stopped with the STREAMING state.
+ */
+typedef enum
+{
+    CMD_STATE_COMMAND,
+    CMD_STATE_IDLE,
+    CMD_STATE_STREAMING,
+    CMD_STATE_COUNT,
+} CmdState_t;
+
+typedef enum
+{
+    CMD_EVENT_START,
+    CMD_EVENT_STOP,
+    CMD_EVENT_COUNT,
+} CmdEvent_t;
+
+static void streaming_entry(void *ctx);
+static void streaming_exit(void *ctx);
+
+static const FsmTableTransition_t command_transition[CMD_STATE_COUNT][CMD_EVENT_COUNT] =
+{
+    [CMD_STATE_COMMAND][CMD_EVENT_START] = FSM_TABLE_GOTO(CMD_STATE_STREAMING, NULL),
+    [CMD_STATE_STREAMING][CMD_EVENT_STOP] = FSM_TABLE_GOTO(CMD_STATE_IDLE, NULL),
+};
+
+static const FsmTableStateHook_t command_state_hook[CMD_STATE_COUNT] =
+{
+    [CMD_STATE_COMMAND] = { .initial = FSM_TABLE_INITIAL(CMD_STATE_IDLE) },
+    [CMD_STATE_IDLE] = { .parent = FSM_TABLE_PARENT(CMD_STATE_COMMAND) },
+    [CMD_STATE_STREAMING] = { .entry = streaming_entry, .exit = streaming_exit,
+            .parent = FSM_TABLE_PARENT(CMD_STATE_COMMAND) },
+};
+
+static const FsmTable_t command_table =
+        FSM_TABLE(command_transition, command_state_hook, CMD_STATE_COMMAND);
+
+static FsmActive_t command_fsm;
+static FsmTableEvent_t command_queue[COMMAND_QUEUE_SIZE];
+static SchedTask_Handle_t send_task = CUSTOM_SCHEDULER_HANDLE_NONE;
+
+static SchedTask_Handle_t parse_task = CUSTOM_SCHEDULER_HANDLE_NONE;
+CUSTOM_MAILBOX_DEFINE(rx_mailbox, uint8_t, BUFFER_SIZE)
 static uint8_t read_char;
 static size_t start_cmd_curr_pos;
 static size_t end_cmd_curr_pos;
+static size_t trace_cmd_curr_pos;
+static size_t status_cmd_curr_pos;
 
 void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
 {
     if (huart->Instance == USART2)
     {
         HAL_UART_Receive_IT(huart, &read_char, 1);
-        // if buffer is full, the data will be discarded
-        Custom_CirBuff_Insert(&cirbuff, BUFFER_SIZE, sizeof(uint8_t), &buff_head, &buff_count, &read_char);
-        // print back the character read
+        // if the mailbox is full, the character is dropped (and counted)
+        rx_mailbox_post(&read_char);
+        // print back the character read (dropped while a line is being sent, see
+        // uart_send_response.c)
         HAL_UART_Transmit(huart, &read_char, 1, 10);
     }
 }
 
-static uint8_t parse_command(const uint8_t *cmd, size_t cmd_len, size_t *curr_pos)
+static void streaming_entry(void *ctx)
+{
+    send_task = uart_send_start(3000);
+    // the conversion and the transmit are waited for without running, each step is short
+    Custom_Scheduler_SetBudget(send_task, CUSTOM_SCHEDULER_MS_TO_TICK(50), SCHED_BUDGET_LOG);
+}
+
+static void streaming_exit(void *ctx)
 {
-    if (buff_count > 0)
+    uart_send_stop();
+    send_task = CUSTOM_SCHEDULER_HANDLE_NONE;
+}
+
+static uint8_t parse_command(uint8_t c, const uint8_t *cmd, size_t cmd_len, size_t *curr_pos)
+{
+    if (c == cmd[*curr_pos])
     {
-        if (cirbuff[buff_head] == cmd[*curr_pos])
-        {
-            (*curr_pos)++;
-        }
-        else
-        {
-            *curr_pos = 0;
-        }
+        (*curr_pos)++;
+    }
+    else
+    {
+        // the mismatched character may still start a new command
+        *curr_pos = (c == cmd[0]) ? 1 : 0;
     }
 
     if (*curr_pos >= cmd_len)
@@ -63,29 +135,44 @@ static uint8_t parse_command(const uint8_t *cmd, size_t cmd_len, size_t *curr_po
 
 void uart_receive_init(void)
 {
-    buff_head = 0;
-    buff_count = 0;
+    Custom_Mailbox_Init(&rx_mailbox, rx_mailbox_buffer, sizeof(uint8_t), BUFFER_SIZE);
     start_cmd_curr_pos = 0;
     end_cmd_curr_pos = 0;
+    trace_cmd_curr_pos = 0;
+    status_cmd_curr_pos = 0;
+    Custom_Fsm_ActiveInit(&command_fsm, &command_table, NULL, command_queue,
+            COMMAND_QUEUE_SIZE, 1, TASK_COMMAND_ID);
+    parse_task = Custom_Scheduler_AddEvent(uart_receive_parse, NULL, 1, TASK_RECEIVE_ID);
+    Custom_Mailbox_SetReceiver(&rx_mailbox, parse_task);
     HAL_UART_Receive_IT(&huart2, &read_char, 1);
 }
 
-void uart_receive_parse(void *param)
+void uart_receive_get_stat(MailboxStat_t *stat)
 {
-    // parse the newest character read (if exist)
-    if (parse_command(START_CMD, START_CMD_LEN, &start_cmd_curr_pos))
-    {
-        Custom_Scheduler_Add(uart_send_response, NULL, 0,
-                CUSTOM_SCHEDULER_MS_TO_TICK(3000), 0, TASK_SEND_ID);
-    }
-    else if (parse_command(END_CMD, END_CMD_LEN, &end_cmd_curr_pos))
-    {
-        Custom_Scheduler_Delete(TASK_SEND_ID);
-    }
+    Custom_Mailbox_GetStat(&rx_mailbox, stat);
+}
 
-    // then clear that character
-    if (buff_count > 0)
+void uart_receive_parse(void *param)
+{
+    uint8_t c;
+    // parse every character read so far
+    while (rx_mailbox_receive(&c))
     {
-        Custom_CirBuff_Delete(BUFFER_SIZE, &buff_head, &buff_count);
+        if (parse_command(c, START_CMD, START_CMD_LEN, &start_cmd_curr_pos))
+        {
+            Custom_Fsm_Post(&command_fsm, CMD_EVENT_START);
+        }
+        if (parse_command(c, END_CMD, END_CMD_LEN, &end_cmd_curr_pos))
+        {
+            Custom_Fsm_Post(&command_fsm, CMD_EVENT_STOP);
+        }
+        if (parse_command(c, TRACE_CMD, TRACE_CMD_LEN, &trace_cmd_curr_pos))
+        {
+            Custom_Trace_Dump();
+        }
+        if (parse_command(c, STATUS_CMD, STATUS_CMD_LEN, &status_cmd_curr_pos))
+        {
+            uart_send_status_request();
+        }
     }
 }
@@ -6,6 +6,12 @@
  */
 
 #include "SchedTask/uart_send_response.h"
+#include "SchedTask/uart_receive_parse.h"
+#include "Custom/coroutine.h"
+#include "Custom/cpu_load.h"
+#include "Custom/pool.h"
+#include "Custom/scheduler.h"
+#include "Custom/timestamp.h"
 #include "adc.h"
 #include "stm32f1xx_hal_adc.h"
 #include "stm32f1xx_hal_uart.h"
@@ -13,17 +19,294 @@
 #include <inttypes.h>
 #include <stdio.h>
 
+/*
+ * NOTE:
+ * The ADC value is sent by a two stage pipeline of coroutine (see Custom/coroutine.h),
+ * chained in the scheduler:
+ * - uart_send_sample: start a conversion and wait for its interrupt, hand the sample to
+ *   the next stage (Custom_Scheduler_Output), then wait for the next period
+ * - uart_send_response: take the sample (Custom_Scheduler_GetInput), start sending the
+ *   line and wait for the transmit complete interrupt
+ * The conversion and the transmit (~2 ms at 115200 baud) do not hold the scheduler, and
+ * the line is formatted in the same dispatch pass the sample is taken. The sample is
+ * passed by reference, the ISR write every other conversion in a second buffer so a
+ * sample not formatted yet is never overwritten. The line is formatted into a block of
+ * the pool (see Custom/pool.h), freed by the transmit complete interrupt.
+ *
+ * While a line is being sent by interrupt, a blocking transmit return HAL_BUSY. So the
+ * status is sent by its own event task, which wait a tick when the UART is busy (the
+ * trace dump do the same).
+ */
+
+typedef struct
+{
+    uint32_t value;
+    uint32_t time;           // when it was sampled, in us
+} AdcSample_t;
+
+static Coroutine_t sample_co = { .handle = CUSTOM_SCHEDULER_HANDLE_NONE };
+static Coroutine_t send_co = { .handle = CUSTOM_SCHEDULER_HANDLE_NONE };
+static SoftDeadline_t sample_deadline;
+static uint32_t sample_period_us;
+static SchedTask_Handle_t status_task = CUSTOM_SCHEDULER_HANDLE_NONE;
+
+// written by the ISR, the coroutine is woken when they are cleared
+static uint8_t volatile adc_busy = 0;
+static uint8_t volatile tx_busy = 0;
+// the ISR write into adc_sample[adc_index], the other one may be in the next stage
+static AdcSample_t adc_sample[2];
+static uint8_t adc_index = 0;
+static const AdcSample_t *send_sample;
+// line being sent, freed by the ISR once sent
+static uint8_t *volatile tx_block = NULL;
+
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    if (hadc->Instance == ADC1)
+    {
+        adc_sample[adc_index].time = Custom_Timestamp_GetUs();
+        adc_sample[adc_index].value = HAL_ADC_GetValue(hadc);
+        adc_busy = 0;
+        Custom_Coroutine_Wake(&sample_co);
+    }
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart->Instance == USART2)
+    {
+        Custom_Pool_Free(tx_block);
+        tx_block = NULL;
+        tx_busy = 0;
+        Custom_Coroutine_Wake(&send_co);
+    }
+}
+
+void uart_send_sample(void *param)
+{
+    Coroutine_t *co = (Coroutine_t*) param;
+
+    CUSTOM_COROUTINE_BEGIN(co);
+    Custom_SoftTimer_DeadlineSet(&sample_deadline, 0);
+    while (1)
+    {
+        // read the current ADC value (a conversion started before a restart may still
+        // be running)
+        CUSTOM_COROUTINE_WAIT_UNTIL(co, !adc_busy);
+        adc_busy = 1;
+        HAL_ADC_Start_IT(&hadc1);
+        CUSTOM_COROUTINE_WAIT_UNTIL(co, !adc_busy);
+
+        // the next stage run right after this return, the next conversion go to the
+        // other buffer
+        Custom_Scheduler_Output(&adc_sample[adc_index]);
+        adc_index ^= 1;
+
+        Custom_SoftTimer_DeadlineAdvance(&sample_deadline, sample_period_us);
+        CUSTOM_COROUTINE_WAIT_DEADLINE(co, &sample_deadline);
+    }
+    CUSTOM_COROUTINE_END(co);
+}
+
 void uart_send_response(void *param)
 {
-    // read the current ADC value
-    HAL_ADC_Start(&hadc1);
-    HAL_ADC_PollForConversion(&hadc1, HAL_MAX_DELAY);
-    uint32_t adc_value = HAL_ADC_GetValue(&hadc1);
+    Coroutine_t *co = (Coroutine_t*) param;
+
+    CUSTOM_COROUTINE_BEGIN(co);
+    while (1)
+    {
+        // print the value and the time it was sampled (in us) to serial, the sample is
+        // only taken once the previous line is sent
+        CUSTOM_COROUTINE_WAIT_UNTIL(co,
+                !tx_busy && (send_sample = Custom_Scheduler_GetInput()) != NULL);
+        // big enough size for two uint32_t, if the pool is empty the sample is dropped
+        uint8_t *line = Custom_Pool_Alloc(30);
+        if (line != NULL)
+        {
+            size_t len = sprintf((char*) line, "%"PRIu32 " @%"PRIu32 "\r\n",
+                    send_sample->value, send_sample->time);
+            tx_block = line;
+            tx_busy = 1;
+            HAL_UART_Transmit_IT(&huart2, line, len);
+        }
+    }
+    CUSTOM_COROUTINE_END(co);
+}
+
+SchedTask_Handle_t uart_send_start(uint32_t period_ms)
+{
+    sample_period_us = period_ms * 1000u;
+    SchedTask_Handle_t send = Custom_Scheduler_AddEvent(uart_send_response, &send_co, 0,
+            TASK_SEND_ID);
+    SchedTask_Handle_t sample = Custom_Scheduler_AddEvent(uart_send_sample, &sample_co, 0,
+            TASK_SAMPLE_ID);
+    Custom_Coroutine_Init(&send_co, send);
+    Custom_Coroutine_Init(&sample_co, sample);
+    Custom_Scheduler_Chain(sample, send);
+    Custom_Scheduler_Signal(sample);
+    return send;
+}
+
+void uart_send_stop(void)
+{
+    // a conversion or a line in progress end on its own, without waking anything
+    Custom_Scheduler_DeleteHandle(sample_co.handle);
+    Custom_Scheduler_DeleteHandle(send_co.handle);
+    Custom_Coroutine_Init(&sample_co, CUSTOM_SCHEDULER_HANDLE_NONE);
+    Custom_Coroutine_Init(&send_co, CUSTOM_SCHEDULER_HANDLE_NONE);
+}
+
+static uint16_t to_permille(uint32_t cycle, uint32_t total)
+{
+    return (total > 0) ? (uint16_t) (((uint64_t) cycle * 1000u) / total) : 0;
+}
+
+static void send_load(uint8_t second)
+{
+    CpuLoad_t load;
+    Custom_CpuLoad_Get(second, &load);
+    uint16_t busy = Custom_CpuLoad_BusyPermille(&load);
+    uint16_t task = to_permille(load.task_cycle, load.total_cycle);
+    uint16_t isr = to_permille(load.isr_cycle, load.total_cycle);
+
+    uint8_t buff[64];
+    size_t len = sprintf((char*) &buff, "load %us: busy %u.%u%% task %u.%u%% isr %u.%u%%\r\n",
+            second, busy / 10, busy % 10, task / 10, task % 10, isr / 10, isr % 10);
+    HAL_UART_Transmit(&huart2, (uint8_t*) &buff, len, 50);
+}
 
-    // convert the value to a string
-    uint8_t buff[15]; // big enough size for uint32_t
-    size_t len = sprintf((char*) &buff, "%"PRIu32 "\r\n", adc_value);
+static void send_task_stat(SchedTask_Handle_t handle, const SchedTaskStat_t *stat)
+{
+    uint8_t buff[160];
+    size_t len = sprintf((char*) &buff, "task %u: late", handle);
+    for (size_t i = 0; i < CUSTOM_SCHEDULER_LATENESS_BUCKET; i++)
+    {
+        len += sprintf((char*) &buff[len], " %u", stat->lateness[i]);
+    }
+    len += sprintf((char*) &buff[len], " overrun %u skipped %u over budget %u run max %uus\r\n",
+            stat->overrun, stat->skipped, stat->over_budget, stat->max_run_us);
+    HAL_UART_Transmit(&huart2, (uint8_t*) &buff, len, 50);
+}
 
-    // print adc value to serial
+static void send_phase_load(const char *name, const SchedPhaseLoad_t *load)
+{
+    uint8_t buff[96];
+    size_t len = sprintf((char*) &buff,
+            "phase %s: peak %"PRIu32 "us at tick %u, %u busy tick, total %"PRIu32 "us\r\n",
+            name, load->peakUs, load->peakTick, load->busyTick, load->totalUs);
     HAL_UART_Transmit(&huart2, (uint8_t*) &buff, len, 50);
 }
+
+static uint8_t uart_tx_busy(void)
+{
+    return (HAL_UART_GetState(&huart2) & HAL_UART_STATE_BUSY_TX) == HAL_UART_STATE_BUSY_TX;
+}
+
+void uart_send_status(void *param)
+{
+    if (uart_tx_busy())
+    {
+        // a line is being sent, try again on the next tick
+        Custom_Scheduler_Reschedule(status_task, 0, 1);
+        return;
+    }
+
+    send_load(1);
+    send_load(CUSTOM_CPULOAD_WINDOW_S);
+
+    SchedBudgetRecord_t record;
+    if (Custom_Scheduler_GetBudgetRecord(&record))
+    {
+        uint8_t buff[96];
+        size_t len = sprintf((char*) &buff,
+                "over budget: task ID %u (task %u) at tick %"PRIu32 " action %u count %"PRIu32 "\r\n",
+                record.taskID, record.handle, record.tick, record.action, record.count);
+        HAL_UART_Transmit(&huart2, (uint8_t*) &buff, len, 50);
+    }
+
+    SchedTaskStat_t stat;
+    for (SchedTask_Handle_t handle = 0; handle < CUSTOM_SCHEDULER_BIHEAP_SIZE; handle++)
+    {
+        if (Custom_Scheduler_GetStat(handle, &stat))
+        {
+            send_task_stat(handle, &stat);
+        }
+    }
+
+    SchedPhaseReport_t report;
+    if (Custom_Scheduler_GetPhaseReport(&report))
+    {
+        send_phase_load("before", &report.before);
+        send_phase_load("after", &report.after);
+    }
+    SchedPhaseLoad_t load;
+    Custom_Scheduler_GetPhaseLoad(&load, NULL);
+    send_phase_load("now", &load);
+
+    PoolStat_t pool;
+    for (uint8_t i = 0; Custom_Pool_GetStat(i, &pool); i++)
+    {
+        uint8_t buff[80];
+        size_t len = sprintf((char*) &buff,
+                "pool %uB: used %u max %u/%u alloc %"PRIu32 " full %u\r\n",
+                pool.blockSize, pool.used, pool.maxUsed, pool.blockCount, pool.alloc,
+                pool.full);
+        HAL_UART_Transmit(&huart2, (uint8_t*) &buff, len, 50);
+    }
+
+    MailboxStat_t rx;
+    uart_receive_get_stat(&rx);
+    {
+        uint8_t buff[80];
+        size_t len = sprintf((char*) &buff,
+                "rx mailbox: posted %"PRIu32 " dropped %u max depth %u/%u\r\n",
+                rx.posted, rx.dropped, rx.maxDepth, BUFFER_SIZE);
+        HAL_UART_Transmit(&huart2, (uint8_t*) &buff, len, 50);
+    }
+
+#ifdef CUSTOM_SCHEDULER_USE_URGENT_BAND
+    SchedUrgentStat_t urgent;
+    for (SchedTask_Handle_t handle = CUSTOM_SCHEDULER_BIHEAP_SIZE;
+            CUSTOM_SCHEDULER_IS_URGENT_HANDLE(handle); handle++)
+    {
+        if (Custom_Scheduler_GetUrgentStat(handle, &urgent))
+        {
+            uint8_t buff[80];
+            size_t len = sprintf((char*) &buff,
+                    "urgent %u: run %"PRIu32 " max latency %"PRIu32 "us overrun %u\r\n",
+                    handle, urgent.run, urgent.maxLatencyUs, urgent.overrun);
+            HAL_UART_Transmit(&huart2, (uint8_t*) &buff, len, 50);
+        }
+    }
+#endif
+
+#ifdef CUSTOM_SCHEDULER_POLICY_EDF
+    {
+        uint32_t density = Custom_Scheduler_GetUtilization() / 1000u;
+        uint8_t buff[32];
+        size_t len = sprintf((char*) &buff, "edf: admitted %"PRIu32 ".%"PRIu32 "%%\r\n",
+                density / 10u, density % 10u);
+        HAL_UART_Transmit(&huart2, (uint8_t*) &buff, len, 50);
+    }
+#endif
+
+#ifdef CUSTOM_SCHEDULER_USE_CYCLIC
+    SchedCyclicStat_t cyclic;
+    Custom_Scheduler_GetCyclicStat(&cyclic);
+    uint8_t buff[80];
+    size_t len = sprintf((char*) &buff,
+            "cyclic: frame %"PRIu32 " skipped %u max frame %"PRIu32 "us\r\n",
+            cyclic.frame, cyclic.skipped, cyclic.maxFrameUs);
+    HAL_UART_Transmit(&huart2, (uint8_t*) &buff, len, 50);
+#endif
+}
+
+void uart_send_init(void)
+{
+    status_task = Custom_Scheduler_AddEvent(uart_send_status, NULL, 1, TASK_STATUS_ID);
+}
+
+void uart_send_status_request(void)
+{
+    Custom_Scheduler_Signal(status_task);
+}
@@ -24,8 +24,14 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "Custom/cpu_load.h"
+#include "Custom/pool.h"
 #include "Custom/scheduler.h"
+#include "Custom/software_timer.h"
+#include "Custom/timestamp.h"
+#include "Custom/trace.h"
 #include "SchedTask/uart_receive_parse.h"
+#include "SchedTask/uart_send_response.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -60,7 +66,10 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
 {
     if (htim->Instance == TIM3)
     {
+        Custom_Timestamp_TickUpdate();
         Custom_Scheduler_Update();
+        Custom_CpuLoad_TickUpdate();
+        Custom_SoftTimer_ServiceTick();
     }
 }
 
@@ -100,11 +109,20 @@ int main(void)
     MX_USART2_UART_Init();
     MX_ADC1_Init();
     /* USER CODE BEGIN 2 */
+    Custom_Timestamp_Init();
+    Custom_CpuLoad_Init();
+    Custom_Trace_Init();
+    Custom_SoftTimer_ServiceInit();
+    Custom_Pool_Init();
+    uart_send_init();
     uart_receive_init();
-    Custom_Scheduler_Add(uart_receive_parse, NULL, 0,
-            CUSTOM_SCHEDULER_MS_TO_TICK(10), 0, 0);
+#ifndef CUSTOM_SCHEDULER_USE_CYCLIC
+    // run from the static table otherwise (Tools/cyclic_taskset.json)
     Custom_Scheduler_Add(task_blink_led, NULL, 0,
             CUSTOM_SCHEDULER_MS_TO_TICK(500), 0, 0);
+#endif
+    // release the periodic task on different tick (from the phase they were added with)
+    Custom_Scheduler_SpreadPhase();
     Custom_Scheduler_Init();
     /* USER CODE END 2 */
 
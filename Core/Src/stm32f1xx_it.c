@@ -22,6 +22,9 @@
 #include "stm32f1xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "Custom/cpu_load.h"
+#include "Custom/scheduler.h"
+#include "Custom/trace.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -172,7 +175,11 @@ void DebugMon_Handler(void)
 void PendSV_Handler(void)
 {
   /* USER CODE BEGIN PendSV_IRQn 0 */
-
+#ifdef CUSTOM_SCHEDULER_USE_URGENT_BAND
+  CUSTOM_CPULOAD_ISR_ENTER();
+  Custom_Scheduler_RunUrgent();
+  CUSTOM_CPULOAD_ISR_EXIT();
+#endif
   /* USER CODE END PendSV_IRQn 0 */
   /* USER CODE BEGIN PendSV_IRQn 1 */
 
@@ -185,11 +192,11 @@ void PendSV_Handler(void)
 void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
-
+  CUSTOM_CPULOAD_ISR_ENTER();
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
-
+  CUSTOM_CPULOAD_ISR_EXIT();
   /* USER CODE END SysTick_IRQn 1 */
 }
 
@@ -206,11 +213,13 @@ void SysTick_Handler(void)
 void ADC1_2_IRQHandler(void)
 {
   /* USER CODE BEGIN ADC1_2_IRQn 0 */
-
+  CUSTOM_CPULOAD_ISR_ENTER();
+  CUSTOM_TRACE(TRACE_EVENT_ISR_ENTER, ADC1_2_IRQn, 0);
   /* USER CODE END ADC1_2_IRQn 0 */
   HAL_ADC_IRQHandler(&hadc1);
   /* USER CODE BEGIN ADC1_2_IRQn 1 */
-
+  CUSTOM_TRACE(TRACE_EVENT_ISR_EXIT, ADC1_2_IRQn, 0);
+  CUSTOM_CPULOAD_ISR_EXIT();
   /* USER CODE END ADC1_2_IRQn 1 */
 }
 
@@ -220,11 +229,13 @@ void ADC1_2_IRQHandler(void)
 void TIM3_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM3_IRQn 0 */
-
+  CUSTOM_CPULOAD_ISR_ENTER();
+  CUSTOM_TRACE(TRACE_EVENT_ISR_ENTER, TIM3_IRQn, 0);
   /* USER CODE END TIM3_IRQn 0 */
   HAL_TIM_IRQHandler(&htim3);
   /* USER CODE BEGIN TIM3_IRQn 1 */
-
+  CUSTOM_TRACE(TRACE_EVENT_ISR_EXIT, TIM3_IRQn, 0);
+  CUSTOM_CPULOAD_ISR_EXIT();
   /* USER CODE END TIM3_IRQn 1 */
 }
 
@@ -234,11 +245,13 @@ void TIM3_IRQHandler(void)
 void USART2_IRQHandler(void)
 {
   /* USER CODE BEGIN USART2_IRQn 0 */
-
+  CUSTOM_CPULOAD_ISR_ENTER();
+  CUSTOM_TRACE(TRACE_EVENT_ISR_ENTER, USART2_IRQn, 0);
   /* USER CODE END USART2_IRQn 0 */
   HAL_UART_IRQHandler(&huart2);
   /* USER CODE BEGIN USART2_IRQn 1 */
-
+  CUSTOM_TRACE(TRACE_EVENT_ISR_EXIT, USART2_IRQn, 0);
+  CUSTOM_CPULOAD_ISR_EXIT();
   /* USER CODE END USART2_IRQn 1 */
 }
 
@@ -248,11 +261,11 @@ void USART2_IRQHandler(void)
 void EXTI15_10_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI15_10_IRQn 0 */
-
+  CUSTOM_CPULOAD_ISR_ENTER();
   /* USER CODE END EXTI15_10_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(B1_Pin);
   /* USER CODE BEGIN EXTI15_10_IRQn 1 */
-
+  CUSTOM_CPULOAD_ISR_EXIT();
   /* USER CODE END EXTI15_10_IRQn 1 */
 }
 
@@ -0,0 +1,44 @@
+/*
+ * bench.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#ifndef HOST_BENCH_BENCH_H_
+#define HOST_BENCH_BENCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * NOTE:
+ * Microbenchmark for the Custom module, built for the host (see Host/CMakeLists.txt).
+ *
+ * Each result is printed as one JSON object per line (JSON Lines), so the output of
+ * different build (heap arity, commit) can be compared by a script
+ * (Tools/bench_compare.py):
+ * {"suite": "pqueue", "bench": "insert", "arity": 2, "n": 1023, "ops": 2000000,
+ *  "ns_per_op": 12.3, "ops_per_sec": 81300813}
+ *
+ * Every suite run its benchmark for a few size (n), and repeat each one until at
+ * least BENCH_MIN_OPS operation are timed.
+ */
+
+#define BENCH_MIN_OPS (1000000u)
+
+// monotonic time in ns
+uint64_t bench_now_ns(void);
+// print one result line
+void bench_report(const char *suite, const char *bench, size_t n, uint64_t ops,
+        uint64_t elapsed_ns);
+// small deterministic pseudo-random generator, so every build get the same input
+uint32_t bench_rand(void);
+void bench_seed(uint32_t seed);
+
+void bench_pqueue(void);
+void bench_cirbuff(void);
+void bench_timer(void);
+void bench_scheduler(void);
+
+#endif /* HOST_BENCH_BENCH_H_ */
@@ -0,0 +1,43 @@
+/*
+ * bench_cirbuff.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#include "bench.h"
+#include "Custom/circular_buffer.h"
+
+#define RING_SIZE (64u)
+
+static uint8_t ring_byte[RING_SIZE];
+static uint32_t ring_word[RING_SIZE];
+
+// keep the ring half full, insert one element and delete one per operation
+static void bench_ring(const char *name, void *ring, size_t esize)
+{
+    size_t head = 0;
+    size_t count = 0;
+    uint32_t value = 0;
+
+    for (size_t i = 0; i < RING_SIZE / 2; i++)
+    {
+        Custom_CirBuff_Insert(ring, RING_SIZE, esize, &head, &count, &value);
+    }
+
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_MIN_OPS; i++)
+    {
+        value = i;
+        Custom_CirBuff_Insert(ring, RING_SIZE, esize, &head, &count, &value);
+        Custom_CirBuff_Delete(RING_SIZE, &head, &count);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    bench_report("cirbuff", name, RING_SIZE, BENCH_MIN_OPS, elapsed);
+}
+
+void bench_cirbuff(void)
+{
+    bench_ring("insert_delete_u8", ring_byte, sizeof(uint8_t));
+    bench_ring("insert_delete_u32", ring_word, sizeof(uint32_t));
+}
@@ -0,0 +1,93 @@
+/*
+ * bench_main.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#include "bench.h"
+#include "Custom/priority_queue.h"
+#include "Custom/scheduler.h"
+#include "Custom/software_timer.h"
+#include "Custom/timestamp.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static uint32_t rand_state = 1u;
+
+uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+void bench_report(const char *suite, const char *bench, size_t n, uint64_t ops,
+        uint64_t elapsed_ns)
+{
+    double ns_per_op = (ops > 0) ? (double) elapsed_ns / (double) ops : 0.0;
+    double ops_per_sec = (elapsed_ns > 0) ? (double) ops * 1e9 / (double) elapsed_ns : 0.0;
+    printf("{\"suite\": \"%s\", \"bench\": \"%s\", \"arity\": %d, \"n\": %zu, "
+            "\"ops\": %llu, \"ns_per_op\": %.2f, \"ops_per_sec\": %.0f}\n",
+            suite, bench, CUSTOM_PQUEUE_ARITY, n, (unsigned long long) ops, ns_per_op,
+            ops_per_sec);
+    fflush(stdout);
+}
+
+uint32_t bench_rand(void)
+{
+    // xorshift32
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+void bench_seed(uint32_t seed)
+{
+    rand_state = (seed != 0) ? seed : 1u;
+}
+
+// task of the cyclic executive table (Tools/cyclic_taskset.json), defined by main.c on
+// the target, nothing to do here
+void task_blink_led(void *param)
+{
+}
+
+// what the TIM3 callback do on the target, run at the end of each dispatch pass
+static void bench_tick(void)
+{
+    Custom_Scheduler_Update();
+    Custom_Timestamp_TickUpdate();
+    Custom_SoftTimer_ServiceTick();
+}
+
+int main(int argc, char **argv)
+{
+    Custom_Timestamp_Init();
+    Custom_SoftTimer_ServiceInit();
+    Custom_Scheduler_Init();
+    HalStub_SleepHook = bench_tick;
+
+    // run every suite, or only the one named on the command line
+    const char *only = (argc > 1) ? argv[1] : NULL;
+
+    if (only == NULL || strcmp(only, "pqueue") == 0)
+    {
+        bench_pqueue();
+    }
+    if (only == NULL || strcmp(only, "cirbuff") == 0)
+    {
+        bench_cirbuff();
+    }
+    if (only == NULL || strcmp(only, "timer") == 0)
+    {
+        bench_timer();
+    }
+    if (only == NULL || strcmp(only, "scheduler") == 0)
+    {
+        bench_scheduler();
+    }
+    return 0;
+}
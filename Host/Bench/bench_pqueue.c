@@ -0,0 +1,225 @@
+/*
+ * bench_pqueue.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#include "bench.h"
+#include "Custom/priority_queue.h"
+#include <stdlib.h>
+
+static const size_t heap_size[] = { 15, 31, 255, 1023, 4095 };
+
+// key of a scheduled task: the tick it run at, and its period (0: one-shot)
+typedef struct
+{
+    uint32_t runAt;
+    uint32_t period;
+} BenchTaskKey_t;
+
+// period (in tick) of the periodic task, a mix of harmonic rate
+static const uint32_t task_period[] = { 1, 2, 5, 10, 20, 50, 100 };
+
+#define ONESHOT_BURST (4u)
+#define ONESHOT_BATCH (1024u)
+
+static uint8_t compare_smaller(void *a, void *b)
+{
+    return *(uint32_t*) a < *(uint32_t*) b;
+}
+
+// the task running first on top, as the scheduler waiting heap
+static uint8_t compare_run_later(void *a, void *b)
+{
+    return ((BenchTaskKey_t*) a)->runAt > ((BenchTaskKey_t*) b)->runAt;
+}
+
+static void fill_random(uint32_t *arr, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        arr[i] = bench_rand();
+    }
+}
+
+// insert n random key into an empty heap
+static void bench_insert(uint32_t *heap, size_t n)
+{
+    uint64_t ops = 0;
+    uint64_t elapsed = 0;
+    uint32_t *key = malloc(n * sizeof(uint32_t));
+
+    while (ops < BENCH_MIN_OPS)
+    {
+        fill_random(key, n);
+        uint64_t start = bench_now_ns();
+        for (size_t i = 0; i < n; i++)
+        {
+            Custom_PQueue_Insert(heap, n, sizeof(uint32_t), i, &key[i], compare_smaller);
+        }
+        elapsed += bench_now_ns() - start;
+        ops += n;
+    }
+    bench_report("pqueue", "insert", n, ops, elapsed);
+    free(key);
+}
+
+// pop every key from a full heap
+static void bench_pop(uint32_t *heap, size_t n)
+{
+    uint64_t ops = 0;
+    uint64_t elapsed = 0;
+
+    while (ops < BENCH_MIN_OPS)
+    {
+        fill_random(heap, n);
+        Custom_PQueue_Create(heap, n, sizeof(uint32_t), n, compare_smaller);
+        uint64_t start = bench_now_ns();
+        for (size_t count = n; count > 0; count--)
+        {
+            Custom_PQueue_Pop(heap, n, sizeof(uint32_t), count, compare_smaller);
+        }
+        elapsed += bench_now_ns() - start;
+        ops += n;
+    }
+    bench_report("pqueue", "pop", n, ops, elapsed);
+}
+
+// delete key at random position from a full heap until empty
+static void bench_delete(uint32_t *heap, size_t n)
+{
+    uint64_t ops = 0;
+    uint64_t elapsed = 0;
+    size_t *index = malloc(n * sizeof(size_t));
+
+    while (ops < BENCH_MIN_OPS)
+    {
+        fill_random(heap, n);
+        for (size_t count = n; count > 0; count--)
+        {
+            index[n - count] = bench_rand() % count;
+        }
+        Custom_PQueue_Create(heap, n, sizeof(uint32_t), n, compare_smaller);
+        uint64_t start = bench_now_ns();
+        for (size_t count = n; count > 0; count--)
+        {
+            Custom_PQueue_Delete(heap, n, sizeof(uint32_t), count, index[n - count],
+                    compare_smaller);
+        }
+        elapsed += bench_now_ns() - start;
+        ops += n;
+    }
+    bench_report("pqueue", "delete", n, ops, elapsed);
+    free(index);
+}
+
+// build a heap from n random key in one go
+static void bench_create(uint32_t *heap, size_t n)
+{
+    uint64_t ops = 0;
+    uint64_t elapsed = 0;
+
+    while (ops < BENCH_MIN_OPS)
+    {
+        fill_random(heap, n);
+        uint64_t start = bench_now_ns();
+        Custom_PQueue_Create(heap, n, sizeof(uint32_t), n, compare_smaller);
+        elapsed += bench_now_ns() - start;
+        ops += n;
+    }
+    bench_report("pqueue", "create", n, ops, elapsed);
+}
+
+// periodic reload (pop heavy): the task on top run, its key move one period later and
+// sink back (pop + re-insert in one push down), as a full heap of periodic task do
+static void bench_reload(size_t n)
+{
+    uint64_t ops = 0;
+    uint64_t elapsed = 0;
+    BenchTaskKey_t *heap = malloc(n * sizeof(BenchTaskKey_t));
+    size_t period_count = sizeof(task_period) / sizeof(task_period[0]);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        heap[i].period = task_period[bench_rand() % period_count];
+        heap[i].runAt = bench_rand() % heap[i].period;
+    }
+    Custom_PQueue_Create(heap, n, sizeof(BenchTaskKey_t), n, compare_run_later);
+    while (ops < BENCH_MIN_OPS)
+    {
+        uint64_t start = bench_now_ns();
+        for (size_t i = 0; i < n; i++)
+        {
+            heap[0].runAt += heap[0].period;
+            Custom_PQueue_PushDown(heap, sizeof(BenchTaskKey_t), n, compare_run_later);
+        }
+        elapsed += bench_now_ns() - start;
+        ops += n;
+    }
+    bench_report("pqueue", "reload", n, ops, elapsed);
+    free(heap);
+}
+
+// one-shot (insert heavy): with half the heap taken by periodic task due later, a burst
+// of one-shot task due within a few tick is inserted (each climb near the top), then
+// each is popped once when it run
+static void bench_oneshot(size_t n)
+{
+    uint64_t ops = 0;
+    uint64_t elapsed = 0;
+    size_t background = n / 2;
+    BenchTaskKey_t *heap = malloc(n * sizeof(BenchTaskKey_t));
+    BenchTaskKey_t *oneshot = malloc(ONESHOT_BATCH * sizeof(BenchTaskKey_t));
+
+    for (size_t i = 0; i < background; i++)
+    {
+        heap[i].period = 1;
+        heap[i].runAt = 1000u + bench_rand() % (1u << 20);
+    }
+    Custom_PQueue_Create(heap, n, sizeof(BenchTaskKey_t), background, compare_run_later);
+    for (size_t i = 0; i < ONESHOT_BATCH; i++)
+    {
+        oneshot[i].period = 0;
+        oneshot[i].runAt = bench_rand() % 8u;
+    }
+    while (ops < BENCH_MIN_OPS)
+    {
+        uint64_t start = bench_now_ns();
+        for (size_t i = 0; i < ONESHOT_BATCH; i += ONESHOT_BURST)
+        {
+            size_t count = background;
+            for (size_t j = 0; j < ONESHOT_BURST && count < n; j++, count++)
+            {
+                Custom_PQueue_Insert(heap, n, sizeof(BenchTaskKey_t), count, &oneshot[i + j],
+                        compare_run_later);
+            }
+            for (; count > background; count--)
+            {
+                Custom_PQueue_Pop(heap, n, sizeof(BenchTaskKey_t), count, compare_run_later);
+            }
+        }
+        elapsed += bench_now_ns() - start;
+        ops += ONESHOT_BATCH;
+    }
+    bench_report("pqueue", "oneshot", n, ops, elapsed);
+    free(oneshot);
+    free(heap);
+}
+
+void bench_pqueue(void)
+{
+    for (size_t i = 0; i < sizeof(heap_size) / sizeof(heap_size[0]); i++)
+    {
+        size_t n = heap_size[i];
+        uint32_t *heap = malloc(n * sizeof(uint32_t));
+        bench_seed(n);
+        bench_insert(heap, n);
+        bench_pop(heap, n);
+        bench_delete(heap, n);
+        bench_create(heap, n);
+        bench_reload(n);
+        bench_oneshot(n);
+        free(heap);
+    }
+}
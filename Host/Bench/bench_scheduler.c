@@ -0,0 +1,69 @@
+/*
+ * bench_scheduler.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#include "bench.h"
+#include "Custom/scheduler.h"
+#include <stdlib.h>
+
+// the timer service already take one task slot
+static const size_t task_count[] = { 8, 64, 512, CUSTOM_SCHEDULER_BIHEAP_SIZE - 8 };
+
+static volatile uint32_t run_count = 0;
+
+static void task_empty(void *param)
+{
+    run_count++;
+}
+
+// n task due every tick, time per task run (including the dispatch overhead)
+static void bench_dispatch(SchedTask_Handle_t *handle, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        handle[i] = Custom_Scheduler_Add(task_empty, NULL, (uint8_t) (bench_rand() % 4u), 1, 0,
+                (uint8_t) i);
+    }
+
+    uint32_t pass = (uint32_t) (BENCH_MIN_OPS / n) + 1u;
+    run_count = 0;
+    uint64_t start = bench_now_ns();
+    for (uint32_t p = 0; p < pass; p++)
+    {
+        Custom_Scheduler_Dispatch();
+    }
+    bench_report("scheduler", "dispatch_per_task", n, run_count, bench_now_ns() - start);
+}
+
+// add then delete one task while n other are waiting
+static void bench_add_delete(size_t n)
+{
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_MIN_OPS; i++)
+    {
+        SchedTask_Handle_t handle = Custom_Scheduler_Add(task_empty, NULL, 0,
+                1u + (i & 0xFFu), 1u + (i & 0xFFu), 0);
+        Custom_Scheduler_DeleteHandle(handle);
+    }
+    bench_report("scheduler", "add_delete", n, BENCH_MIN_OPS, bench_now_ns() - start);
+}
+
+void bench_scheduler(void)
+{
+    for (size_t i = 0; i < sizeof(task_count) / sizeof(task_count[0]); i++)
+    {
+        size_t n = task_count[i];
+        SchedTask_Handle_t *handle = malloc(n * sizeof(SchedTask_Handle_t));
+        bench_seed(n);
+        bench_dispatch(handle, n);
+        bench_add_delete(n);
+        for (size_t j = 0; j < n; j++)
+        {
+            Custom_Scheduler_DeleteHandle(handle[j]);
+        }
+        free(handle);
+    }
+}
@@ -0,0 +1,128 @@
+/*
+ * bench_timer.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#include "bench.h"
+#include "Custom/scheduler.h"
+#include "Custom/software_timer.h"
+#include <stdlib.h>
+
+static const size_t timer_count[] = { 16, 256, 4096 };
+
+#define TICK_COUNT (20000u)
+
+static volatile uint32_t fired = 0;
+
+static void on_fire(void *arg)
+{
+    fired++;
+}
+
+// one SoftTimer_t update per timer per tick
+static void bench_legacy_tick(size_t n)
+{
+    SoftTimer_t *tm = calloc(n, sizeof(SoftTimer_t));
+    for (size_t i = 0; i < n; i++)
+    {
+        Custom_SoftTimer_SetDurationTick(&tm[i], (bench_rand() % 100000u) * TIMER_TICK_DURATION_MS);
+    }
+
+    uint64_t start = bench_now_ns();
+    for (uint32_t t = 0; t < TICK_COUNT; t++)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            Custom_SoftTimer_TickUpdate(&tm[i]);
+        }
+    }
+    bench_report("timer", "legacy_tick", n, TICK_COUNT, bench_now_ns() - start);
+    free(tm);
+}
+
+// tick ISR of the timer service alone (the service task is not run)
+static void bench_wheel_tick(SoftTimerEntry_t *tm, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        Custom_SoftTimer_Start(&tm[i], 1u + bench_rand() % 100000u, 0, on_fire, NULL);
+    }
+
+    uint64_t start = bench_now_ns();
+    for (uint32_t t = 0; t < TICK_COUNT; t++)
+    {
+        Custom_SoftTimer_ServiceTick();
+    }
+    bench_report("timer", "wheel_tick", n, TICK_COUNT, bench_now_ns() - start);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        Custom_SoftTimer_Stop(&tm[i]);
+    }
+    // let the service task catch up with the tick above
+    Custom_Scheduler_Dispatch();
+}
+
+// tick ISR and service task, with every timer periodic (100 to 1099 tick)
+static void bench_wheel_service(SoftTimerEntry_t *tm, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t period = 100u + bench_rand() % 1000u;
+        Custom_SoftTimer_Start(&tm[i], period, period, on_fire, NULL);
+    }
+
+    // each dispatch pass end with one tick (see bench_main.c)
+    uint64_t start = bench_now_ns();
+    for (uint32_t t = 0; t < TICK_COUNT; t++)
+    {
+        Custom_Scheduler_Dispatch();
+    }
+    bench_report("timer", "wheel_service_tick", n, TICK_COUNT, bench_now_ns() - start);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        Custom_SoftTimer_Stop(&tm[i]);
+    }
+}
+
+// start then stop one timer while n other are running
+static void bench_wheel_start_stop(SoftTimerEntry_t *tm, size_t n)
+{
+    SoftTimerEntry_t extra = { 0 };
+
+    for (size_t i = 0; i < n; i++)
+    {
+        Custom_SoftTimer_Start(&tm[i], 1u + bench_rand() % 100000u, 0, on_fire, NULL);
+    }
+
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_MIN_OPS; i++)
+    {
+        Custom_SoftTimer_Start(&extra, 1u + (i & 0xFFFu), 0, on_fire, NULL);
+        Custom_SoftTimer_Stop(&extra);
+    }
+    bench_report("timer", "wheel_start_stop", n, BENCH_MIN_OPS, bench_now_ns() - start);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        Custom_SoftTimer_Stop(&tm[i]);
+    }
+}
+
+void bench_timer(void)
+{
+    for (size_t i = 0; i < sizeof(timer_count) / sizeof(timer_count[0]); i++)
+    {
+        size_t n = timer_count[i];
+        SoftTimerEntry_t *tm = calloc(n, sizeof(SoftTimerEntry_t));
+        bench_seed(n);
+        bench_legacy_tick(n);
+        bench_wheel_tick(tm, n);
+        bench_wheel_service(tm, n);
+        bench_wheel_start_stop(tm, n);
+        free(tm);
+    }
+}
@@ -0,0 +1,11 @@
+# Run every benchmark executable in BENCH_COMMANDS, concatenate their output into
+# BENCH_OUTPUT (JSON Lines). Used by the run_bench target.
+
+file(WRITE ${BENCH_OUTPUT} "")
+foreach(command ${BENCH_COMMANDS})
+  execute_process(COMMAND ${command} OUTPUT_VARIABLE output RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${command} failed: ${result}")
+  endif()
+  file(APPEND ${BENCH_OUTPUT} "${output}")
+endforeach()
@@ -0,0 +1,78 @@
+/*
+ * sim.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#ifndef HOST_SIM_SIM_H_
+#define HOST_SIM_SIM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * NOTE:
+ * Virtual time simulator: the whole firmware (main.c, the interrupt handler of
+ * stm32f1xx_it.c, the scheduled task) run on the host against simulated peripheral:
+ * - TIM3: update event every 10 ms, with the counter running at 1 MHz
+ * - SysTick: every 1 ms
+ * - USART2: receive a byte stream at line rate (115200 baud), transmitted byte are
+ *   captured. A byte arriving while the previous one is still unread is lost (overrun).
+ *   A transmit by interrupt end with its interrupt once all byte are sent
+ * - ADC1: each conversion return the next sample of a list (or a ramp), a conversion
+ *   by interrupt end with its interrupt
+ *
+ * Code run in zero virtual time, only blocking HAL call (UART transmit, ADC
+ * conversion), interrupt driven transfer and sleep take time. When the firmware sleep, the time jump straight to
+ * the next interrupt, so the simulation run as fast as the host allow, and the same
+ * input always give the same output.
+ *
+ * Interrupt have the same priority on the target, so handler never nest: an event
+ * happening while an handler run (or while interrupt are masked) is only latched, its
+ * handler run once interrupt are unmasked, lowest exception number first.
+ *
+ * Response latency: time from the reception of a mark byte (end of a command, '#') to
+ * the first transmit of more than one byte (the echo of each received byte is a one
+ * byte transmit). A mark followed by another mark without response is unanswered.
+ */
+
+typedef struct
+{
+    uint64_t duration_ns;
+    // received byte stream, sent rx_repeat time (0: until the end)
+    const uint8_t *rx_data;
+    size_t rx_len;
+    uint32_t rx_repeat;
+    uint64_t rx_start_ns;
+    uint64_t rx_gap_ns;
+    uint8_t rx_mark;
+    // transmitted byte are written there (NULL: discarded)
+    FILE *tx_file;
+    // ADC sample replayed in loop (NULL: 12 bit ramp)
+    const uint32_t *adc_sample;
+    size_t adc_count;
+} SimConfig_t;
+
+typedef struct
+{
+    uint64_t now_ns;
+    uint64_t rx_byte;
+    uint64_t rx_overrun;
+    uint64_t tx_byte;
+    uint64_t adc_conversion;
+    uint64_t response;
+    uint64_t unanswered;
+    uint64_t latency_min_ns;
+    uint64_t latency_max_ns;
+    uint64_t latency_sum_ns;
+} SimStat_t;
+
+// set up the peripheral and the HAL stub hook, before the firmware start
+void sim_init(const SimConfig_t *config);
+const SimStat_t* sim_stat(void);
+// called once the simulated time is over (or on reset), report and exit
+void sim_end(const char *reason);
+
+#endif /* HOST_SIM_SIM_H_ */
@@ -0,0 +1,197 @@
+/*
+ * sim_main.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#include "sim.h"
+#include "Custom/cpu_load.h"
+#include "Custom/error.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * NOTE:
+ * Configuration, from the environment:
+ * - SIM_DURATION_MS: simulated time (default 10000)
+ * - SIM_RX_FILE: byte received over USART2, a file or "-" for stdin (read whole
+ *   before the simulation start)
+ * - SIM_RX_REPEAT: number of time the received byte are sent, 0 for until the end
+ *   (default 1)
+ * - SIM_RX_START_MS / SIM_RX_GAP_MS: time of the first byte, and pause between two
+ *   repetition (default 100 / 0)
+ * - SIM_RX_MARK: end of a command, for the response latency (default '#')
+ * - SIM_TX_FILE: file the transmitted byte are written to (default: discarded)
+ * - SIM_ADC_FILE: ADC sample, whitespace separated (default: a ramp)
+ *
+ * At the end, a report is printed on stdout as one JSON object.
+ */
+
+// the firmware main(), renamed when main.c is built for the simulator
+int firmware_main(void);
+
+static uint64_t host_start_ns;
+
+static uint64_t host_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static uint64_t env_u64(const char *name, uint64_t value)
+{
+    const char *env = getenv(name);
+    return (env != NULL && *env != '\0') ? strtoull(env, NULL, 0) : value;
+}
+
+static uint8_t* read_file(const char *path, size_t *len)
+{
+    FILE *f = (strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "sim: cannot open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    size_t size = 0;
+    size_t capacity = 4096;
+    uint8_t *data = malloc(capacity);
+    size_t n;
+    while (data != NULL && (n = fread(data + size, 1, capacity - size, f)) > 0)
+    {
+        size += n;
+        if (size == capacity)
+        {
+            capacity *= 2;
+            data = realloc(data, capacity);
+        }
+    }
+    if (f != stdin)
+    {
+        fclose(f);
+    }
+    if (data == NULL)
+    {
+        fprintf(stderr, "sim: out of memory reading %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    *len = size;
+    return data;
+}
+
+static uint32_t* read_sample(const char *path, size_t *count)
+{
+    size_t len;
+    char *text = (char*) read_file(path, &len);
+    text = realloc(text, len + 1);
+    text[len] = '\0';
+
+    // at most one sample every two character
+    uint32_t *sample = malloc((len / 2 + 1) * sizeof(uint32_t));
+    size_t n = 0;
+    char *pos = text;
+    char *end;
+    for (unsigned long value = strtoul(pos, &end, 0); end != pos;
+            value = strtoul(pos, &end, 0))
+    {
+        sample[n++] = (uint32_t) value & 0xFFFu; // 12 bit ADC
+        pos = end;
+    }
+    free(text);
+
+    *count = n;
+    return sample;
+}
+
+static void print_error(void)
+{
+    uint8_t first = 1;
+    printf("\"error\": [");
+    for (uint32_t err = 0; err < ERR_COUNT; err++)
+    {
+        if ((err_bit & (1u << err)) && ERR_DESCRIPTION[err] != NULL)
+        {
+            printf("%s\"%s\"", first ? "" : ", ", ERR_DESCRIPTION[err]);
+            first = 0;
+        }
+    }
+    printf("]");
+}
+
+void sim_end(const char *reason)
+{
+    const SimStat_t *stat = sim_stat();
+    uint64_t host_ns = host_now_ns() - host_start_ns;
+
+    CpuLoad_t load;
+    Custom_CpuLoad_Get(CUSTOM_CPULOAD_WINDOW_S, &load);
+    uint16_t busy = Custom_CpuLoad_BusyPermille(&load);
+
+    printf("{\"end\": \"%s\", \"sim_ms\": %.3f, \"host_ms\": %.3f, \"speedup\": %.0f, ",
+            reason, stat->now_ns / 1e6, host_ns / 1e6,
+            (host_ns > 0) ? (double) stat->now_ns / (double) host_ns : 0.0);
+    printf("\"rx_byte\": %llu, \"rx_overrun\": %llu, \"tx_byte\": %llu, "
+            "\"adc_conversion\": %llu, ",
+            (unsigned long long) stat->rx_byte, (unsigned long long) stat->rx_overrun,
+            (unsigned long long) stat->tx_byte, (unsigned long long) stat->adc_conversion);
+    printf("\"response\": %llu, \"unanswered\": %llu, ",
+            (unsigned long long) stat->response, (unsigned long long) stat->unanswered);
+    if (stat->response > 0)
+    {
+        printf("\"latency_us\": {\"min\": %.1f, \"avg\": %.1f, \"max\": %.1f}, ",
+                stat->latency_min_ns / 1e3,
+                (double) stat->latency_sum_ns / (double) stat->response / 1e3,
+                stat->latency_max_ns / 1e3);
+    }
+    printf("\"busy_permille_%us\": %u, ", CUSTOM_CPULOAD_WINDOW_S, busy);
+    print_error();
+    printf("}\n");
+    fflush(stdout);
+
+    exit(EXIT_SUCCESS);
+}
+
+int main(void)
+{
+    SimConfig_t config;
+    memset(&config, 0, sizeof(config));
+    config.duration_ns = env_u64("SIM_DURATION_MS", 10000) * 1000000u;
+    config.rx_repeat = (uint32_t) env_u64("SIM_RX_REPEAT", 1);
+    config.rx_start_ns = env_u64("SIM_RX_START_MS", 100) * 1000000u;
+    config.rx_gap_ns = env_u64("SIM_RX_GAP_MS", 0) * 1000000u;
+
+    const char *mark = getenv("SIM_RX_MARK");
+    config.rx_mark = (mark != NULL && *mark != '\0') ? (uint8_t) mark[0] : '#';
+
+    const char *path = getenv("SIM_RX_FILE");
+    if (path != NULL && *path != '\0')
+    {
+        uint8_t *data = read_file(path, &config.rx_len);
+        config.rx_data = data;
+    }
+    path = getenv("SIM_TX_FILE");
+    if (path != NULL && *path != '\0')
+    {
+        config.tx_file = fopen(path, "wb");
+        if (config.tx_file == NULL)
+        {
+            fprintf(stderr, "sim: cannot open %s\n", path);
+            return EXIT_FAILURE;
+        }
+    }
+    path = getenv("SIM_ADC_FILE");
+    if (path != NULL && *path != '\0')
+    {
+        uint32_t *sample = read_sample(path, &config.adc_count);
+        config.adc_sample = sample;
+    }
+
+    sim_init(&config);
+    host_start_ns = host_now_ns();
+    // never return, the simulation end in sim_end()
+    return firmware_main();
+}
@@ -0,0 +1,290 @@
+/*
+ * sim_periph.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#include "sim.h"
+#include "main.h"
+#include "stm32f1xx_it.h"
+
+// on the target: 64 MHz core, TIM3 update every 10 ms, SysTick every 1 ms
+#define SIM_CORE_MHZ (64u)
+#define SIM_TICK_NS (10000000u)
+#define SIM_SYSTICK_NS (1000000u)
+#define SIM_NEVER (UINT64_MAX)
+
+static SimConfig_t config;
+static SimStat_t stat;
+
+static uint64_t next_systick_ns;
+static uint64_t next_tick_ns;
+static uint64_t tick_start_ns;
+static uint32_t systick_pending;
+static uint8_t in_isr;
+static uint8_t in_pendsv;
+
+static uint64_t next_adc_ns;
+static uint64_t next_tx_ns;
+static uint64_t next_rx_ns;
+static size_t rx_pos;
+static uint32_t rx_pass;
+static uint8_t mark_pending;
+static uint64_t mark_ns;
+
+static void set_time(uint64_t t)
+{
+    stat.now_ns = t;
+    HalStub_TimCounter = (uint32_t) ((t - tick_start_ns) / 1000u);
+    HalStub_Dwt.CYCCNT = (uint32_t) (t * SIM_CORE_MHZ / 1000u);
+}
+
+static uint64_t next_event(void)
+{
+    uint64_t next = (next_systick_ns < next_tick_ns) ? next_systick_ns : next_tick_ns;
+    next = (next_adc_ns < next) ? next_adc_ns : next;
+    next = (next_tx_ns < next) ? next_tx_ns : next;
+    return (next_rx_ns < next) ? next_rx_ns : next;
+}
+
+static void receive_byte(void)
+{
+    uint8_t c = config.rx_data[rx_pos];
+    stat.rx_byte++;
+    if (HalStub_UartRxPending)
+    {
+        stat.rx_overrun++;
+    }
+    else
+    {
+        HalStub_UartRxData = c;
+        HalStub_UartRxPending = 1;
+    }
+
+    if (c == config.rx_mark)
+    {
+        stat.unanswered += mark_pending;
+        mark_pending = 1;
+        mark_ns = stat.now_ns;
+    }
+
+    // next byte, or the start of the next pass
+    next_rx_ns += HALSTUB_UART_BYTE_NS;
+    if (++rx_pos >= config.rx_len)
+    {
+        rx_pos = 0;
+        rx_pass++;
+        next_rx_ns += config.rx_gap_ns;
+        if (config.rx_repeat != 0 && rx_pass >= config.rx_repeat)
+        {
+            next_rx_ns = SIM_NEVER;
+        }
+    }
+}
+
+// set the pending flag of every event due at the current time
+static void latch_event(void)
+{
+    if (next_systick_ns <= stat.now_ns)
+    {
+        systick_pending = 1;
+        next_systick_ns += SIM_SYSTICK_NS;
+    }
+    if (next_tick_ns <= stat.now_ns)
+    {
+        HalStub_TimUpdatePending |= TIM_FLAG_UPDATE;
+        tick_start_ns = next_tick_ns;
+        next_tick_ns += SIM_TICK_NS;
+        set_time(stat.now_ns);
+    }
+    if (next_adc_ns <= stat.now_ns)
+    {
+        HalStub_AdcEocPending = 1;
+        next_adc_ns = SIM_NEVER;
+    }
+    if (next_tx_ns <= stat.now_ns)
+    {
+        HalStub_UartTxCpltPending = 1;
+        next_tx_ns = SIM_NEVER;
+    }
+    if (next_rx_ns <= stat.now_ns)
+    {
+        receive_byte();
+    }
+}
+
+static uint8_t irq_pending(void)
+{
+    return systick_pending || HalStub_AdcEocPending
+            || (HalStub_TimUpdatePending & TIM_FLAG_UPDATE) || HalStub_UartTxCpltPending
+            || (HalStub_UartRxPending && HalStub_UartRxArmed());
+}
+
+static uint8_t pendsv_pending(void)
+{
+    return (SCB->ICSR & SCB_ICSR_PENDSVSET_Msk) && !in_pendsv;
+}
+
+// run the handler of every pending interrupt, unless already in an handler or masked
+// PendSV has the lowest priority: run once the other are done, and preempted by them
+static void run_pending(void)
+{
+    if (in_isr || HalStub_Primask)
+    {
+        return;
+    }
+
+    in_isr = 1;
+    while (irq_pending() || pendsv_pending())
+    {
+        if (!irq_pending())
+        {
+            SCB->ICSR &= ~SCB_ICSR_PENDSVSET_Msk;
+            in_pendsv = 1;
+            in_isr = 0;
+            PendSV_Handler();
+            in_isr = 1;
+            in_pendsv = 0;
+            continue;
+        }
+
+        if (systick_pending)
+        {
+            systick_pending = 0;
+            SysTick_Handler();
+        }
+        else if (HalStub_AdcEocPending)
+        {
+            ADC1_2_IRQHandler();
+        }
+        else if (HalStub_TimUpdatePending & TIM_FLAG_UPDATE)
+        {
+            TIM3_IRQHandler();
+        }
+        else
+        {
+            USART2_IRQHandler();
+        }
+    }
+    in_isr = 0;
+}
+
+// move the time forward, taking every interrupt happening on the way
+static void advance_to(uint64_t t)
+{
+    for (uint64_t next = next_event(); next <= t; next = next_event())
+    {
+        if (next >= config.duration_ns)
+        {
+            set_time(config.duration_ns);
+            sim_end("duration");
+        }
+        set_time(next);
+        latch_event();
+        run_pending();
+    }
+    set_time(t);
+}
+
+static void sim_sleep(void)
+{
+    // WFI: wait for an enabled interrupt, its handler run once unmasked
+    while (!irq_pending() && !pendsv_pending())
+    {
+        advance_to(next_event());
+    }
+}
+
+static void sim_delay(uint32_t ns)
+{
+    advance_to(stat.now_ns + ns);
+}
+
+// an interrupt driven transfer started, its interrupt is due in ns
+static void sim_pend(IRQn_Type irq, uint32_t ns)
+{
+    if (irq == ADC1_2_IRQn)
+    {
+        next_adc_ns = stat.now_ns + ns;
+    }
+    else if (irq == USART2_IRQn)
+    {
+        next_tx_ns = stat.now_ns + ns;
+    }
+}
+
+static void sim_uart_tx(const uint8_t *data, uint16_t size)
+{
+    stat.tx_byte += size;
+    if (config.tx_file != NULL)
+    {
+        fwrite(data, 1, size, config.tx_file);
+    }
+
+    if (mark_pending && size > 1)
+    {
+        uint64_t latency = stat.now_ns - mark_ns;
+        mark_pending = 0;
+        stat.response++;
+        stat.latency_sum_ns += latency;
+        if (latency < stat.latency_min_ns)
+        {
+            stat.latency_min_ns = latency;
+        }
+        if (latency > stat.latency_max_ns)
+        {
+            stat.latency_max_ns = latency;
+        }
+    }
+}
+
+static uint32_t sim_adc(void)
+{
+    uint64_t n = stat.adc_conversion++;
+    if (config.adc_count > 0)
+    {
+        return config.adc_sample[n % config.adc_count];
+    }
+    return (uint32_t) (n * 16u) & 0xFFFu;
+}
+
+static void sim_reset(void)
+{
+    sim_end("reset");
+}
+
+void sim_init(const SimConfig_t *sim_config)
+{
+    config = *sim_config;
+    memset(&stat, 0, sizeof(stat));
+    stat.latency_min_ns = SIM_NEVER;
+
+    next_systick_ns = SIM_SYSTICK_NS;
+    next_tick_ns = SIM_TICK_NS;
+    tick_start_ns = 0;
+    systick_pending = 0;
+    in_isr = 0;
+    in_pendsv = 0;
+    SCB->ICSR = 0;
+    rx_pos = 0;
+    rx_pass = 0;
+    mark_pending = 0;
+    next_adc_ns = SIM_NEVER;
+    next_tx_ns = SIM_NEVER;
+    next_rx_ns = (config.rx_len > 0) ? config.rx_start_ns : SIM_NEVER;
+    set_time(0);
+
+    HalStub_SleepHook = sim_sleep;
+    HalStub_IrqHook = run_pending;
+    HalStub_DelayHook = sim_delay;
+    HalStub_PendHook = sim_pend;
+    HalStub_UartTxHook = sim_uart_tx;
+    HalStub_AdcHook = sim_adc;
+    HalStub_ResetHook = sim_reset;
+}
+
+const SimStat_t* sim_stat(void)
+{
+    return &stat;
+}
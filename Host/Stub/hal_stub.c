@@ -0,0 +1,295 @@
+/*
+ * hal_stub.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#include "main.h"
+#include "adc.h"
+#include "gpio.h"
+#include "tim.h"
+#include "usart.h"
+#include <stdlib.h>
+
+DWT_Type HalStub_Dwt;
+CoreDebug_Type HalStub_CoreDebug;
+SCB_Type HalStub_Scb;
+GPIO_TypeDef HalStub_GpioA;
+GPIO_TypeDef HalStub_GpioB;
+GPIO_TypeDef HalStub_GpioC;
+ADC_HandleTypeDef hadc1;
+TIM_HandleTypeDef htim3;
+UART_HandleTypeDef huart2;
+
+uint32_t HalStub_Primask = 0;
+void (*HalStub_IrqHook)(void) = NULL;
+void (*HalStub_SleepHook)(void) = NULL;
+void (*HalStub_ResetHook)(void) = NULL;
+void (*HalStub_DelayHook)(uint32_t ns) = NULL;
+void (*HalStub_PendHook)(IRQn_Type irq, uint32_t ns) = NULL;
+void (*HalStub_UartTxHook)(const uint8_t *data, uint16_t size) = NULL;
+uint32_t (*HalStub_AdcHook)(void) = NULL;
+
+uint32_t HalStub_TimCounter = 0;
+uint32_t HalStub_TimUpdatePending = 0;
+uint8_t HalStub_UartRxData = 0;
+uint32_t HalStub_UartRxPending = 0;
+uint32_t HalStub_UartTxCpltPending = 0;
+uint32_t HalStub_AdcEocPending = 0;
+uint32_t HalStub_UartTxByte = 0;
+
+static uint32_t hal_tick = 0;
+static uint8_t *uart_rx_buffer = NULL;
+static uint8_t uart_tx_busy = 0;
+static uint32_t adc_value = 0;
+
+static void delay(uint32_t ns)
+{
+    if (HalStub_DelayHook != NULL)
+    {
+        HalStub_DelayHook(ns);
+    }
+}
+
+static void pend(IRQn_Type irq, uint32_t ns, uint32_t *flag)
+{
+    if (HalStub_PendHook != NULL)
+    {
+        HalStub_PendHook(irq, ns);
+    }
+    else
+    {
+        *flag = 1;
+    }
+}
+
+/* Initialization (in place of the CubeMx generated one) ---------------------*/
+HAL_StatusTypeDef HAL_Init(void)
+{
+    hal_tick = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct,
+        uint32_t FLatency)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef *PeriphClkInit)
+{
+    return HAL_OK;
+}
+
+void MX_GPIO_Init(void)
+{
+    HalStub_GpioA.ODR = 0;
+    HalStub_GpioB.ODR = 0;
+    HalStub_GpioC.ODR = 0;
+}
+
+void MX_ADC1_Init(void)
+{
+    hadc1.Instance = ADC1;
+}
+
+void MX_TIM3_Init(void)
+{
+    htim3.Instance = TIM3;
+}
+
+void MX_USART2_UART_Init(void)
+{
+    huart2.Instance = USART2;
+}
+
+/* Core ----------------------------------------------------------------------*/
+void HAL_IncTick(void)
+{
+    hal_tick++;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return hal_tick;
+}
+
+void HAL_PWR_EnterSLEEPMode(uint32_t Regulator, uint8_t SLEEPEntry)
+{
+    if (HalStub_SleepHook != NULL)
+    {
+        HalStub_SleepHook();
+    }
+}
+
+// priority are not modelled, the simulator run PendSV below every other interrupt
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+}
+
+void NVIC_SystemReset(void)
+{
+    if (HalStub_ResetHook != NULL)
+    {
+        HalStub_ResetHook();
+    }
+    exit(EXIT_FAILURE);
+}
+
+/* GPIO ----------------------------------------------------------------------*/
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    GPIOx->ODR ^= GPIO_Pin;
+}
+
+void HAL_GPIO_EXTI_IRQHandler(uint16_t GPIO_Pin)
+{
+}
+
+/* TIM -----------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim)
+{
+    return HAL_OK;
+}
+
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim)
+{
+    if (HalStub_TimUpdatePending & TIM_FLAG_UPDATE)
+    {
+        HalStub_TimUpdatePending &= ~TIM_FLAG_UPDATE;
+        HAL_TIM_PeriodElapsedCallback(htim);
+    }
+}
+
+__weak void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+}
+
+/* UART ----------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size,
+        uint32_t Timeout)
+{
+    if (uart_tx_busy)
+    {
+        return HAL_BUSY;
+    }
+    HalStub_UartTxByte += Size;
+    if (HalStub_UartTxHook != NULL)
+    {
+        HalStub_UartTxHook(pData, Size);
+    }
+    delay(Size * HALSTUB_UART_BYTE_NS);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, uint8_t *pData,
+        uint16_t Size)
+{
+    if (uart_tx_busy)
+    {
+        return HAL_BUSY;
+    }
+    uart_tx_busy = 1;
+    HalStub_UartTxByte += Size;
+    if (HalStub_UartTxHook != NULL)
+    {
+        HalStub_UartTxHook(pData, Size);
+    }
+    pend(USART2_IRQn, Size * HALSTUB_UART_BYTE_NS, &HalStub_UartTxCpltPending);
+    return HAL_OK;
+}
+
+HAL_UART_StateTypeDef HAL_UART_GetState(UART_HandleTypeDef *huart)
+{
+    uint32_t state = HAL_UART_STATE_READY;
+    state |= uart_tx_busy ? HAL_UART_STATE_BUSY_TX : 0;
+    state |= (uart_rx_buffer != NULL) ? HAL_UART_STATE_BUSY_RX : 0;
+    return (HAL_UART_StateTypeDef) state;
+}
+
+// only single byte reception is used by the firmware
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData,
+        uint16_t Size)
+{
+    if (uart_rx_buffer != NULL)
+    {
+        return HAL_BUSY;
+    }
+    uart_rx_buffer = pData;
+    return HAL_OK;
+}
+
+uint8_t HalStub_UartRxArmed(void)
+{
+    return uart_rx_buffer != NULL;
+}
+
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart)
+{
+    if (HalStub_UartRxPending && uart_rx_buffer != NULL)
+    {
+        uint8_t *buffer = uart_rx_buffer;
+        *buffer = HalStub_UartRxData;
+        HalStub_UartRxPending = 0;
+        uart_rx_buffer = NULL;
+        HAL_UART_RxCpltCallback(huart);
+    }
+    if (HalStub_UartTxCpltPending)
+    {
+        HalStub_UartTxCpltPending = 0;
+        uart_tx_busy = 0;
+        HAL_UART_TxCpltCallback(huart);
+    }
+}
+
+__weak void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+}
+
+__weak void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+}
+
+/* ADC -----------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc)
+{
+    adc_value = (HalStub_AdcHook != NULL) ? HalStub_AdcHook() : 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_PollForConversion(ADC_HandleTypeDef *hadc, uint32_t Timeout)
+{
+    delay(HALSTUB_ADC_CONVERSION_NS);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start_IT(ADC_HandleTypeDef *hadc)
+{
+    HAL_ADC_Start(hadc);
+    pend(ADC1_2_IRQn, HALSTUB_ADC_CONVERSION_NS, &HalStub_AdcEocPending);
+    return HAL_OK;
+}
+
+uint32_t HAL_ADC_GetValue(ADC_HandleTypeDef *hadc)
+{
+    return adc_value;
+}
+
+void HAL_ADC_IRQHandler(ADC_HandleTypeDef *hadc)
+{
+    if (HalStub_AdcEocPending)
+    {
+        HalStub_AdcEocPending = 0;
+        HAL_ADC_ConvCpltCallback(hadc);
+    }
+}
+
+__weak void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+}
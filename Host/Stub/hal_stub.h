@@ -0,0 +1,66 @@
+/*
+ * hal_stub.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#ifndef HOST_STUB_HAL_STUB_H_
+#define HOST_STUB_HAL_STUB_H_
+
+#include "stm32f1xx_hal.h"
+
+/*
+ * NOTE:
+ * Hook into the HAL stub, for the host program (benchmark, simulator). A NULL hook
+ * do nothing, so the benchmark only set the one it need.
+ * - HalStub_SleepHook: called in place of the WFI at the end of a dispatch pass, it
+ *   usually advance the time up to the next interrupt
+ * - HalStub_ResetHook: called by NVIC_SystemReset (then the program exit)
+ * - HalStub_IrqHook: called when interrupt are unmasked, to run the pending handler
+ * - HalStub_DelayHook: called by blocking HAL function with the time (in ns) the call
+ *   take on the target (UART transmit, ADC conversion)
+ * - HalStub_PendHook: called when an interrupt driven transfer start (UART transmit,
+ *   ADC conversion), with its interrupt and the time (in ns) till it end. The host
+ *   program then set the flag below and run the handler (NULL: the flag is set right
+ *   away)
+ * - HalStub_UartTxHook: every byte sent over UART, before the transmit delay
+ * - HalStub_AdcHook: return the value of the next ADC conversion
+ *
+ * Register / interrupt flag, set by the host program:
+ * - HalStub_TimCounter / HalStub_TimUpdatePending: TIM3 counter and update flag, the
+ *   update flag is cleared by HAL_TIM_IRQHandler, which then call the period elapsed
+ *   callback
+ * - HalStub_UartRxData / HalStub_UartRxPending: USART2 data register and RXNE flag,
+ *   HAL_UART_IRQHandler hand the byte to the HAL_UART_Receive_IT buffer if one is
+ *   armed (HalStub_UartRxArmed), then call the receive complete callback
+ * - HalStub_UartTxCpltPending: USART2 transmit complete flag, HAL_UART_IRQHandler end
+ *   the transmit and call the transmit complete callback. A blocking transmit return
+ *   HAL_BUSY while a transmit by interrupt is in progress (as the HAL)
+ * - HalStub_AdcEocPending: ADC1 end of conversion flag, HAL_ADC_IRQHandler call the
+ *   conversion complete callback
+ * - HalStub_UartTxByte: number of byte sent over UART
+ */
+
+// on the target: USART2 at 115200 baud 8N1, ADC at 8 MHz with 1.5 cycle sampling time
+#define HALSTUB_UART_BYTE_NS (1000000000u / (115200u / 10u))
+#define HALSTUB_ADC_CONVERSION_NS (14u * 125u)
+
+extern void (*HalStub_SleepHook)(void);
+extern void (*HalStub_ResetHook)(void);
+extern void (*HalStub_DelayHook)(uint32_t ns);
+extern void (*HalStub_PendHook)(IRQn_Type irq, uint32_t ns);
+extern void (*HalStub_UartTxHook)(const uint8_t *data, uint16_t size);
+extern uint32_t (*HalStub_AdcHook)(void);
+
+extern uint32_t HalStub_TimCounter;
+extern uint32_t HalStub_TimUpdatePending;
+extern uint8_t HalStub_UartRxData;
+extern uint32_t HalStub_UartRxPending;
+extern uint32_t HalStub_UartTxCpltPending;
+extern uint32_t HalStub_AdcEocPending;
+extern uint32_t HalStub_UartTxByte;
+
+uint8_t HalStub_UartRxArmed(void);
+
+#endif /* HOST_STUB_HAL_STUB_H_ */
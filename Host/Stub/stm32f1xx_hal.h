@@ -0,0 +1,266 @@
+/*
+ * stm32f1xx_hal.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#ifndef HOST_STUB_STM32F1XX_HAL_H_
+#define HOST_STUB_STM32F1XX_HAL_H_
+
+/*
+ * NOTE:
+ * Host replacement for the HAL and CMSIS header pulled in by Core/Inc/main.h, so the
+ * project own header (main.h, tim.h, usart.h, adc.h, gpio.h) are used unchanged.
+ * Only what the firmware use is provided. Core and peripheral register are plain
+ * variable, peripheral handle only keep their Instance.
+ *
+ * Nothing run concurrently on the host: an "interrupt" is a call to its handler made
+ * by the host program (see hal_stub.h). PRIMASK is still tracked, so that the host
+ * program does not call an handler while interrupt are masked, and unmasking it give
+ * the host program a chance to run the pending one (HalStub_IrqHook).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define __weak __attribute__((weak))
+
+typedef enum
+{
+    RESET = 0, SET = !RESET
+} FlagStatus;
+
+typedef enum
+{
+    HAL_OK = 0x00U, HAL_ERROR = 0x01U, HAL_BUSY = 0x02U, HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+/* CMSIS ---------------------------------------------------------------------*/
+typedef enum
+{
+    PendSV_IRQn = -2,
+    SysTick_IRQn = -1,
+    ADC1_2_IRQn = 18,
+    TIM3_IRQn = 29,
+    USART2_IRQn = 38,
+    EXTI15_10_IRQn = 40,
+} IRQn_Type;
+
+extern uint32_t HalStub_Primask;
+extern void (*HalStub_IrqHook)(void);
+
+static inline uint32_t __get_PRIMASK(void)
+{
+    return HalStub_Primask;
+}
+
+static inline void __set_PRIMASK(uint32_t primask)
+{
+    HalStub_Primask = primask;
+    if (primask == 0 && HalStub_IrqHook != NULL)
+    {
+        HalStub_IrqHook();
+    }
+}
+
+static inline void __disable_irq(void)
+{
+    HalStub_Primask = 1;
+}
+
+static inline void __enable_irq(void)
+{
+    __set_PRIMASK(0);
+}
+
+static inline uint32_t __LDREXW(volatile uint32_t *addr)
+{
+    return *addr;
+}
+
+static inline uint32_t __STREXW(uint32_t value, volatile uint32_t *addr)
+{
+    *addr = value;
+    return 0;
+}
+
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct
+{
+    volatile uint32_t ICSR;
+} SCB_Type;
+
+extern DWT_Type HalStub_Dwt;
+extern CoreDebug_Type HalStub_CoreDebug;
+extern SCB_Type HalStub_Scb;
+
+#define DWT (&HalStub_Dwt)
+#define CoreDebug (&HalStub_CoreDebug)
+#define SCB (&HalStub_Scb)
+#define SCB_ICSR_PENDSVSET_Msk (1u << 28)
+#define CoreDebug_DEMCR_TRCENA_Msk (1u << 24)
+#define DWT_CTRL_CYCCNTENA_Msk (1u << 0)
+
+void NVIC_SystemReset(void);
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+
+/* Peripheral instance (base address on the target) --------------------------*/
+#define TIM3 (0x40000400u)
+#define USART2 (0x40004400u)
+#define ADC1 (0x40012400u)
+
+/* RCC -----------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t PLLState;
+    uint32_t PLLSource;
+    uint32_t PLLMUL;
+} RCC_PLLInitTypeDef;
+
+typedef struct
+{
+    uint32_t OscillatorType;
+    uint32_t HSIState;
+    uint32_t HSICalibrationValue;
+    RCC_PLLInitTypeDef PLL;
+} RCC_OscInitTypeDef;
+
+typedef struct
+{
+    uint32_t ClockType;
+    uint32_t SYSCLKSource;
+    uint32_t AHBCLKDivider;
+    uint32_t APB1CLKDivider;
+    uint32_t APB2CLKDivider;
+} RCC_ClkInitTypeDef;
+
+typedef struct
+{
+    uint32_t PeriphClockSelection;
+    uint32_t AdcClockSelection;
+} RCC_PeriphCLKInitTypeDef;
+
+#define RCC_OSCILLATORTYPE_HSI (0x00000002U)
+#define RCC_HSI_ON (0x00000001U)
+#define RCC_HSICALIBRATION_DEFAULT (0x10U)
+#define RCC_PLL_ON (0x00000002U)
+#define RCC_PLLSOURCE_HSI_DIV2 (0x00000000U)
+#define RCC_PLL_MUL16 (0x00380000U)
+#define RCC_CLOCKTYPE_SYSCLK (0x00000001U)
+#define RCC_CLOCKTYPE_HCLK (0x00000002U)
+#define RCC_CLOCKTYPE_PCLK1 (0x00000004U)
+#define RCC_CLOCKTYPE_PCLK2 (0x00000008U)
+#define RCC_SYSCLKSOURCE_PLLCLK (0x00000002U)
+#define RCC_SYSCLK_DIV1 (0x00000000U)
+#define RCC_HCLK_DIV1 (0x00000000U)
+#define RCC_HCLK_DIV2 (0x00000400U)
+#define RCC_PERIPHCLK_ADC (0x00000002U)
+#define RCC_ADCPCLK2_DIV8 (0x0000C000U)
+#define FLASH_LATENCY_2 (0x00000002U)
+
+HAL_StatusTypeDef HAL_Init(void);
+void HAL_IncTick(void);
+uint32_t HAL_GetTick(void);
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct);
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct,
+        uint32_t FLatency);
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef *PeriphClkInit);
+
+/* GPIO ----------------------------------------------------------------------*/
+typedef struct
+{
+    volatile uint32_t ODR;
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef HalStub_GpioA;
+extern GPIO_TypeDef HalStub_GpioB;
+extern GPIO_TypeDef HalStub_GpioC;
+
+#define GPIOA (&HalStub_GpioA)
+#define GPIOB (&HalStub_GpioB)
+#define GPIOC (&HalStub_GpioC)
+#define GPIO_PIN_2 ((uint16_t) 0x0004)
+#define GPIO_PIN_3 ((uint16_t) 0x0008)
+#define GPIO_PIN_5 ((uint16_t) 0x0020)
+#define GPIO_PIN_13 ((uint16_t) 0x2000)
+#define GPIO_PIN_14 ((uint16_t) 0x4000)
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_EXTI_IRQHandler(uint16_t GPIO_Pin);
+
+/* TIM -----------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t Instance;
+} TIM_HandleTypeDef;
+
+#define TIM_FLAG_UPDATE (1u << 0)
+#define __HAL_TIM_GET_COUNTER(handle) (HalStub_TimCounter)
+#define __HAL_TIM_GET_FLAG(handle, flag) (HalStub_TimUpdatePending & (flag))
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+
+/* UART ----------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t Instance;
+} UART_HandleTypeDef;
+
+typedef enum
+{
+    HAL_UART_STATE_RESET = 0x00U,
+    HAL_UART_STATE_READY = 0x20U,
+    HAL_UART_STATE_BUSY_TX = 0x21U,
+    HAL_UART_STATE_BUSY_RX = 0x22U,
+    HAL_UART_STATE_BUSY_TX_RX = 0x23U,
+} HAL_UART_StateTypeDef;
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size,
+        uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, uint8_t *pData,
+        uint16_t Size);
+HAL_UART_StateTypeDef HAL_UART_GetState(UART_HandleTypeDef *huart);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData,
+        uint16_t Size);
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart);
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+
+/* ADC -----------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t Instance;
+} ADC_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_Start_IT(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_PollForConversion(ADC_HandleTypeDef *hadc, uint32_t Timeout);
+uint32_t HAL_ADC_GetValue(ADC_HandleTypeDef *hadc);
+void HAL_ADC_IRQHandler(ADC_HandleTypeDef *hadc);
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc);
+
+/* PWR -----------------------------------------------------------------------*/
+#define PWR_MAINREGULATOR_ON (0x00000000U)
+#define PWR_SLEEPENTRY_WFI ((uint8_t) 0x01)
+
+void HAL_PWR_EnterSLEEPMode(uint32_t Regulator, uint8_t SLEEPEntry);
+
+#include "hal_stub.h"
+
+#endif /* HOST_STUB_STM32F1XX_HAL_H_ */
@@ -0,0 +1,14 @@
+/*
+ * stm32f1xx_hal_tim.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: ntpt
+ */
+
+#ifndef HOST_STUB_STM32F1XX_HAL_TIM_H_
+#define HOST_STUB_STM32F1XX_HAL_TIM_H_
+
+// everything is in the HAL stub header
+#include "stm32f1xx_hal.h"
+
+#endif /* HOST_STUB_STM32F1XX_HAL_TIM_H_ */
@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+"""
+bench_compare.py
+
+Compare two benchmark result files (JSON Lines, from the run_bench target of the host
+build, see Host/CMakeLists.txt) and report every benchmark that got slower by more
+than the threshold. Exit with status 1 if any did, so it can be used in a script.
+
+    bench_compare.py baseline.jsonl current.jsonl [--threshold 10]
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    result = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            r = json.loads(line)
+            result[(r["suite"], r["bench"], r["arity"], r["n"])] = r["ns_per_op"]
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="slowdown (in percent) reported as regression")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+    regression = 0
+    for key in sorted(current):
+        if key not in baseline or baseline[key] == 0:
+            continue
+        change = (current[key] - baseline[key]) * 100.0 / baseline[key]
+        mark = ""
+        if change > args.threshold:
+            mark = "  REGRESSION"
+            regression += 1
+        print("%-10s %-20s arity %d n %6d: %10.2f -> %10.2f ns/op (%+6.1f%%)%s"
+              % (key + (baseline[key], current[key], change, mark)))
+
+    return 1 if regression else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
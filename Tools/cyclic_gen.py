@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""
+cyclic_gen.py
+
+Generate the static schedule table of the cyclic executive mode of the scheduler
+(CUSTOM_SCHEDULER_USE_CYCLIC, see Core/Inc/Custom/scheduler.h) from a task set file:
+
+    cyclic_gen.py [Tools/cyclic_taskset.json] [--output path] [--check]
+
+The task set is fixed and harmonic (every period divide the longer ones). The minor
+frame is the shortest period, the major frame the longest one. Each task is given the
+offset (first minor frame) that keep the most loaded frame lightest, then the table
+is checked: every frame must fit its estimated worst case execution time (wcet_us) in
+the minor frame. The generated file re-check the same with _Static_assert, so an
+edited table (or a different tick) fail the build.
+
+With --check, nothing is written, the exit status is 1 if the file on disk is not
+what would be generated (out of date).
+"""
+
+import argparse
+import json
+import os
+import sys
+
+REPO = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+
+
+def fail(message):
+    sys.stderr.write("cyclic_gen: %s\n" % message)
+    sys.exit(2)
+
+
+def load_taskset(path):
+    with open(path) as f:
+        spec = json.load(f)
+    tick_ms = spec["tick_ms"]
+    tasks = spec["tasks"]
+    if not tasks:
+        fail("the task set is empty")
+    names = set()
+    for t in tasks:
+        if t["name"] in names:
+            fail("task %s defined twice" % t["name"])
+        names.add(t["name"])
+        if t["period_ms"] <= 0 or t["period_ms"] % tick_ms:
+            fail("period of %s (%d ms) is not a multiple of the tick (%d ms)"
+                 % (t["name"], t["period_ms"], tick_ms))
+        if not 0 <= t["id"] <= 255:
+            fail("ID of %s does not fit in uint8_t" % t["name"])
+        t.setdefault("arg", "NULL")
+        t["period_tick"] = t["period_ms"] // tick_ms
+    return spec
+
+
+def build_table(tasks):
+    """Return (minor_tick, frame_count, frames), frames[i] is the list of task run in
+    minor frame i."""
+    periods = sorted(set(t["period_tick"] for t in tasks))
+    for short, long in zip(periods, periods[1:]):
+        if long % short:
+            fail("the task set is not harmonic (%d tick does not divide %d tick)"
+                 % (short, long))
+    minor = periods[0]
+    frame_count = periods[-1] // minor
+
+    frames = [[] for _ in range(frame_count)]
+    load = [0] * frame_count
+    # place the most constrained task first: shortest period, then longest run
+    for t in sorted(tasks, key=lambda t: (t["period_tick"], -t["wcet_us"], t["name"])):
+        stride = t["period_tick"] // minor
+        best = min(range(stride),
+                   key=lambda o: (max(load[f] for f in range(o, frame_count, stride)), o))
+        for f in range(best, frame_count, stride):
+            frames[f].append(t)
+            load[f] += t["wcet_us"]
+    return minor, frame_count, frames
+
+
+def macro_name(task):
+    return "CYCLIC_WCET_" + task["name"].upper()
+
+
+def generate(spec, source):
+    tick_ms = spec["tick_ms"]
+    tasks = spec["tasks"]
+    minor, frame_count, frames = build_table(tasks)
+    minor_us = minor * tick_ms * 1000
+    worst = max(sum(t["wcet_us"] for t in frame) for frame in frames)
+    if worst > minor_us:
+        fail("infeasible: a frame need %d us, the minor frame is %d us" % (worst, minor_us))
+    utilization = sum(t["wcet_us"] / (t["period_tick"] * tick_ms * 1000.0) for t in tasks)
+
+    out = []
+    w = out.append
+    name = os.path.basename(spec["output"])
+    w("/*")
+    w(" * %s" % name)
+    w(" *")
+    w(" * Generated by Tools/cyclic_gen.py from %s, do not edit." % source)
+    w(" * major frame %d ms, minor frame %d ms (%d frame), utilization %.3f%%,"
+      % (minor * frame_count * tick_ms, minor * tick_ms, frame_count, utilization * 100))
+    w(" * worst frame %d us" % worst)
+    w(" */")
+    w("")
+    w('#include "Custom/scheduler.h"')
+    w("")
+    w("#ifdef CUSTOM_SCHEDULER_USE_CYCLIC")
+    w("")
+    for func in sorted(set(t["function"] for t in tasks)):
+        w("void %s(void *param);" % func)
+    w("")
+    w("#define CYCLIC_MINOR_TICK %du" % minor)
+    w("#define CYCLIC_MINOR_US %du" % minor_us)
+    w("#define CYCLIC_FRAME_COUNT %du" % frame_count)
+    w("")
+    w("_Static_assert(CUSTOM_SCHEDULER_TICK_DURATION_MS == %d," % tick_ms)
+    w('        "table generated for another tick, run Tools/cyclic_gen.py again");')
+    w("")
+    w("// estimated worst case execution time, in us")
+    for t in tasks:
+        w("#define %s %du" % (macro_name(t), t["wcet_us"]))
+    w("")
+    w("static const SchedCyclicEntry_t cyclic_entry[] =")
+    w("{")
+    first = []
+    for i, frame in enumerate(frames):
+        first.append(sum(len(f) for f in frames[:i]))
+        if frame:
+            w("    // frame %d" % i)
+        for t in frame:
+            w("    { %s, %s, %d }," % (t["function"], t["arg"], t["id"]))
+    w("};")
+    w("")
+    w("static const SchedCyclicFrame_t cyclic_frame[CYCLIC_FRAME_COUNT] =")
+    w("{")
+    for i, frame in enumerate(frames):
+        w("    { %d, %d }," % (first[i], len(frame)))
+    w("};")
+    w("")
+    w("_Static_assert(sizeof(cyclic_entry) / sizeof(cyclic_entry[0]) == %d,"
+      % sum(len(f) for f in frames))
+    w('        "entry count does not match the frame");')
+    for i, frame in enumerate(frames):
+        if frame:
+            w("_Static_assert(%s <= CYCLIC_MINOR_US, \"frame %d overloaded\");"
+              % (" + ".join(macro_name(t) for t in frame), i))
+    w("")
+    w("const SchedCyclicTable_t sched_cyclic_table =")
+    w("{")
+    w("    .minorTick = CYCLIC_MINOR_TICK,")
+    w("    .frameCount = CYCLIC_FRAME_COUNT,")
+    w("    .frame = cyclic_frame,")
+    w("    .entry = cyclic_entry,")
+    w("};")
+    w("")
+    w("#endif")
+    return "\n".join(out) + "\n", minor, frame_count, worst, utilization
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("taskset", nargs="?",
+                        default=os.path.join(REPO, "Tools", "cyclic_taskset.json"))
+    parser.add_argument("--output", help="generated file (default: given in the task set)")
+    parser.add_argument("--check", action="store_true",
+                        help="only check that the generated file is up to date")
+    args = parser.parse_args()
+
+    spec = load_taskset(args.taskset)
+    source = os.path.relpath(os.path.abspath(args.taskset), REPO)
+    text, minor, frame_count, worst, utilization = generate(spec, source)
+    output = args.output or os.path.join(REPO, spec["output"])
+
+    if args.check:
+        try:
+            with open(output) as f:
+                current = f.read()
+        except OSError:
+            current = None
+        if current != text:
+            print("%s is out of date" % output)
+            return 1
+        return 0
+
+    with open(output, "w") as f:
+        f.write(text)
+    print("%s: %d frame of %d tick, worst frame %d us, utilization %.3f%%"
+          % (output, frame_count, minor, worst, utilization * 100))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
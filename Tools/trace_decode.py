@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""
+trace_decode.py
+
+Decode the binary event trace dumped over UART (see Core/Inc/Custom/trace.h) into a
+timeline. The input can be a capture file or a serial port (needs pyserial):
+
+    trace_decode.py capture.bin
+    trace_decode.py --port /dev/ttyACM0 [--baud 115200]
+
+Frame: 0xA5 0x5A, record count, record (12 byte each, little endian), checksum (sum of
+the record byte). Each record: timestamp (uint32, us), event (uint16), arg0 (uint16),
+arg1 (uint32). Anything outside a valid frame (echo, ADC value) is skipped.
+"""
+
+import argparse
+import struct
+import sys
+
+SYNC = b"\xa5\x5a"
+RECORD = struct.Struct("<IHHI")
+
+EVENT_NAME = {
+    0: "LOST",
+    1: "TASK_START",
+    2: "TASK_END",
+    3: "TASK_ADD",
+    4: "TASK_DELETE",
+    5: "ISR_ENTER",
+    6: "ISR_EXIT",
+}
+
+# task run from the cyclic executive table have no handle
+HANDLE_NONE = 0xFFFF
+
+IRQ_NAME = {18: "ADC1_2", 29: "TIM3", 38: "USART2"}
+
+TASK_NAME = {
+    0: "blink_led",
+    121: "uart_send_sample",
+    122: "uart_send_status",
+    123: "uart_send_response",
+    124: "uart_receive_parse",
+    125: "command_fsm",
+    126: "softtimer_service",
+    127: "trace_dump",
+}
+
+
+def parse_frames(data):
+    """Yield (timestamp, event, arg0, arg1) for every valid frame found in data."""
+    pos = 0
+    while True:
+        pos = data.find(SYNC, pos)
+        if pos < 0 or pos + 3 > len(data):
+            return
+        count = data[pos + 2]
+        end = pos + 3 + count * RECORD.size
+        if count == 0 or end + 1 > len(data):
+            pos += 1
+            continue
+        body = data[pos + 3:end]
+        if sum(body) & 0xFF != data[end]:
+            pos += 1
+            continue
+        for i in range(count):
+            yield RECORD.unpack_from(body, i * RECORD.size)
+        pos = end + 1
+
+
+def describe(event, arg0, arg1):
+    if event in (1, 2, 3, 4):
+        handle = "static table" if arg0 == HANDLE_NONE else "handle %d" % arg0
+        return "%s %s (%s)" % (EVENT_NAME[event], TASK_NAME.get(arg1, "id %d" % arg1), handle)
+    if event in (5, 6):
+        return "%s %s" % (EVENT_NAME[event], IRQ_NAME.get(arg0, "irq %d" % arg0))
+    if event == 0:
+        return "LOST %d record" % arg1
+    return "USER 0x%x arg0=%d arg1=%d" % (event, arg0, arg1)
+
+
+def print_timeline(records, out):
+    """Print one line per record, with the time since the previous record and the
+    run time of each task and ISR at its end."""
+    start = {}
+    previous = None
+    base = None
+    for timestamp, event, arg0, arg1 in records:
+        if base is None:
+            base = timestamp
+        # timestamp are the lower 32 bit of the us clock, unwrap them
+        delta = 0 if previous is None else (timestamp - previous) & 0xFFFFFFFF
+        previous = timestamp
+        base_time = (timestamp - base) & 0xFFFFFFFF
+        line = "%12d us  +%8d  %s" % (base_time, delta, describe(event, arg0, arg1))
+        if event in (1, 5):
+            start[(event, arg0)] = timestamp
+        elif event in (2, 6) and (event - 1, arg0) in start:
+            line += "  [%d us]" % ((timestamp - start.pop((event - 1, arg0))) & 0xFFFFFFFF)
+        out.write(line + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file", nargs="?", help="capture file")
+    parser.add_argument("--port", help="serial port to read from")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    if args.port:
+        import serial
+        with serial.Serial(args.port, args.baud, timeout=1) as port:
+            port.write(b"!TRC#")
+            data = bytearray()
+            while True:
+                chunk = port.read(4096)
+                if not chunk:
+                    break
+                data += chunk
+    elif args.file:
+        with open(args.file, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    print_timeline(parse_frames(bytes(data)), sys.stdout)
+
+
+if __name__ == "__main__":
+    main()